@@ -0,0 +1,83 @@
+// Description:
+//      Benchmark for the fleet simulator. A fleet of DERs is simulated over a
+//      full day as fast as possible, in 1 second steps, with an aggregate
+//      dispatch that imports at night and exports in the afternoon. The
+//      wall time, the step time and the device steps per second are reported
+//      for each fleet size.
+//
+// Example:
+//      ./bin/bench/fleet_sim 10000 100000
+
+// INCLUDES
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <map>
+#include "FleetSimulator.h"
+
+// Run
+// - simulate one day for the given fleet size
+static void Run (unsigned int devices) {
+    std::map <std::string, std::string> init;
+    init["devices"] = std::to_string (devices);
+    init["rated_export_power"] = "5000";
+    init["rated_export_energy"] = "10000";
+    init["rated_export_ramp"] = "500";
+    init["rated_import_power"] = "5000";
+    init["rated_import_energy"] = "10000";
+    init["rated_import_ramp"] = "500";
+    init["idle_losses"] = "10";
+    init["normal_mean"] = "0.5";
+    init["standard_deviation"] = "0.2";
+    init["variation"] = "0.2";
+    init["log_path"] = "/tmp/";
+    FleetSimulator fleet (init);
+
+    const double day = 24*60*60;
+    const float step = 1;
+    unsigned int fleet_watts = devices * 2000;
+    auto dispatch = [fleet_watts](FleetSimulator* fleet_ptr, double time) {
+        double hour = time / 3600;
+        if (hour < 6) {
+            fleet_ptr->SetImportWatts (fleet_watts);
+        } else if (hour >= 16 && hour < 20) {
+            fleet_ptr->SetExportWatts (fleet_watts);
+        } else {
+            fleet_ptr->SetImportWatts (0);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now ();
+    fleet.Simulate (day, step, dispatch);
+    std::chrono::duration <double> elapsed
+        = std::chrono::steady_clock::now () - start;
+
+    double steps = day / step;
+    std::cout << std::setw (10) << devices
+        << std::setw (14) << std::fixed << std::setprecision (3)
+        << elapsed.count ()
+        << std::setw (14) << elapsed.count () / steps * 1e6
+        << std::setw (16) << std::setprecision (0)
+        << devices * steps / elapsed.count ()
+        << std::setw (14) << std::setprecision (2)
+        << day / elapsed.count () << "x\n";
+}
+
+int main (int argc, char** argv) {
+    std::cout << std::setw (10) << "devices"
+        << std::setw (14) << "day (s)"
+        << std::setw (14) << "step (us)"
+        << std::setw (16) << "device steps/s"
+        << std::setw (15) << "real time\n";
+
+    if (argc < 2) {
+        Run (10000);
+        Run (100000);
+        return 0;
+    }
+    for (int i = 1; i < argc; i++) {
+        Run (std::stoul (argv[i]));
+    }
+    return 0;
+}
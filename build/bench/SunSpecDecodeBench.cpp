@@ -0,0 +1,452 @@
+// Description:
+//      Micro-benchmark for the SunSpec point decoder. The legacy decoder walked
+//      the smdx property tree on every read and formatted each point into a
+//      string map. This benchmark compares that walk against the compiled
+//      point table (BlockToValues) and the string compatibility view
+//      (BlockToPoints) for the models read by the BESS control loop.
+//
+//      The legacy column is the original BlockToPoints. The diff column is
+//      the number of points where the string view does not match it.
+//
+// Example:
+//      ./bin/bench/sunspec_decode ../data/models/smdx/ 20000
+
+// INCLUDES
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cctype>
+#include <bitset>
+#include <string>
+#include <vector>
+#include <map>
+#include "SunSpecModel.h"
+
+namespace pt = boost::property_tree;
+
+// Legacy Model
+// - the property tree decoder the models used before they were compiled. The
+// - member functions below are copied from the original SunSpecModel.cpp with
+// - only the class renamed and the debug print of count points removed so
+// - the timed loop does not write to the terminal. Scale factors are cached
+// - by name on the first read like the original.
+class LegacyModel {
+public:
+    LegacyModel (const std::string& model_path) {
+        pt::xml_parser::read_xml (model_path, smdx_);
+        LegacyModel::GetScalers ();
+    }
+
+    std::map <std::string, std::string> BlockToPoints (
+        const std::vector <uint16_t>& register_block
+    );
+
+private:
+    void GetScalers ();
+    float BlockToScaler (const std::vector <uint16_t>& register_block,
+                         std::string scaler);
+    uint32_t GetUINT32 (const std::vector <uint16_t>& block,
+                        const unsigned int index);
+    std::string GetString (const std::vector <uint16_t>& block,
+                           const unsigned int index,
+                           const unsigned int length);
+
+private:
+    pt::ptree smdx_;
+    std::map <std::string, uint16_t> scalers_;
+    std::map <std::string, float> sunssf_;
+};
+
+std::map <std::string, std::string> LegacyModel::BlockToPoints (
+    const std::vector <uint16_t>& register_block) {
+    std::map <std::string, std::string> point_map;
+    std::string id, type, scaler;
+    unsigned int offset;
+
+     // Traverse property tree
+    BOOST_FOREACH (pt::ptree::value_type const& node,
+                   smdx_.get_child ("sunSpecModels.model.block")) {
+        pt::ptree subtree = node.second;
+        if( node.first == "point" ) {
+            id = subtree.get <std::string> ("<xmlattr>.id", "");
+            type = subtree.get <std::string> ("<xmlattr>.type", "");
+            scaler = subtree.get <std::string> ("<xmlattr>.sf", "default");
+            offset = subtree.get <unsigned int> ("<xmlattr>.offset", 0);
+
+            // TODO (TS): this should be configured by the smdx file
+            // - the scaled values are a decimal place shift so I use the
+            // - pow() function to raise 10 to the scale value for scaling.
+            if (type == "int16") {
+                int16_t value = register_block[offset];
+                if (sunssf_.count(scaler) == 0){
+                    float scale = LegacyModel::BlockToScaler(
+                        register_block, scaler
+                    );
+                    if (std::isdigit (*scaler.c_str())) {
+                        scaler = id;
+                    }
+                    sunssf_[scaler] = scale;
+                }
+
+                value = value * sunssf_[scaler];
+                point_map[id] = std::to_string(value);
+            } else if (type == "uint16") {
+                uint16_t value = register_block[offset];
+                if (sunssf_.count(scaler) == 0){
+                    float scale = LegacyModel::BlockToScaler(
+                        register_block, scaler
+                    );
+                    if (std::isdigit (*scaler.c_str())) {
+                        scaler = id;
+                    }
+                    sunssf_[scaler] = scale;
+                }
+                value = value * sunssf_[scaler];
+                point_map[id] = std::to_string(value);
+            } else if (type == "count") {
+                uint16_t value = register_block[offset];
+                if (sunssf_.count(scaler) == 0){
+                    float scale = LegacyModel::BlockToScaler(
+                        register_block, scaler
+                    );
+                    if (std::isdigit (*scaler.c_str())) {
+                        scaler = id;
+                    }
+                    sunssf_[scaler] = scale;
+                }
+
+                value = value * sunssf_[scaler];
+                point_map[id] = std::to_string(value);
+            } else if (type == "acc16") {
+                uint16_t value = register_block[offset];
+                if (sunssf_.count(scaler) == 0){
+                    float scale = LegacyModel::BlockToScaler(
+                        register_block, scaler
+                    );
+                    if (std::isdigit (*scaler.c_str())) {
+                        scaler = id;
+                    }
+                    sunssf_[scaler] = scale;
+                }
+
+                value = value * sunssf_[scaler];
+                point_map[id] = std::to_string(value);
+            } else if (type == "int32") {
+                int32_t value = LegacyModel::GetUINT32(register_block,offset);
+                if (sunssf_.count(scaler) == 0){
+                    float scale = LegacyModel::BlockToScaler(
+                        register_block, scaler
+                    );
+                    if (std::isdigit (*scaler.c_str())) {
+                        scaler = id;
+                    }
+                    sunssf_[scaler] = scale;
+                }
+
+                value = value * sunssf_[scaler];
+                point_map[id] = std::to_string(value);
+            } else if (type == "float32") {
+                float value = LegacyModel::GetUINT32(register_block,offset);
+                if (sunssf_.count(scaler) == 0){
+                    float scale = LegacyModel::BlockToScaler(
+                        register_block, scaler
+                    );
+                    if (std::isdigit (*scaler.c_str())) {
+                        scaler = id;
+                    }
+                    sunssf_[scaler] = scale;
+                }
+
+                value = value * sunssf_[scaler];
+                point_map[id] = std::to_string(value);
+            } else if (type == "acc32") {
+                uint32_t value = LegacyModel::GetUINT32(register_block,offset);
+                if (sunssf_.count(scaler) == 0){
+                    float scale = LegacyModel::BlockToScaler(
+                        register_block, scaler
+                    );
+                    if (std::isdigit (*scaler.c_str())) {
+                        scaler = id;
+                    }
+                    sunssf_[scaler] = scale;
+                }
+
+                value = value * sunssf_[scaler];
+                point_map[id] = std::to_string(value);
+            } else if (type == "enum16") {
+                std::string reg = std::to_string(register_block[offset]);
+                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
+                               subtree.get_child("")){
+                    std::string label = subsubtree.first;
+                    if ( label != "<xmlattr>" ) {
+                        pt::ptree symbol = subsubtree.second;
+                        std::string value = symbol.data();
+                        if (value == reg) {
+                            std::string attr = symbol.get <std::string> (
+                                "<xmlattr>.id",""
+                            );
+                            point_map[id] = attr;
+                        }
+                    }
+                }
+            } else if (type == "enum32") {
+                std::string reg = std::to_string(
+                    LegacyModel::GetUINT32(register_block,offset)
+                );
+                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
+                               subtree.get_child("")){
+                    std::string label = subsubtree.first;
+                    if ( label != "<xmlattr>" ) {
+                        pt::ptree symbol = subsubtree.second;
+                        std::string value = symbol.data();
+                        if (value == reg) {
+                            std::string attr = symbol.get <std::string> (
+                                "<xmlattr>.id",""
+                            );
+                            point_map[id] = attr;
+                        }
+                    }
+                }
+            } else if (type == "bitfield16") {
+                std::map <unsigned int, std::string> symbols;
+                std::string sym;
+
+                // collect each bits symbol value
+                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
+                               subtree.get_child("")){
+                    std::string label = subsubtree.first;
+                    if ( label != "<xmlattr>" ) {
+                        pt::ptree symbol = subsubtree.second;
+                        unsigned int value = stoul(symbol.data());
+                        sym = symbol.get <std::string> (
+                            "<xmlattr>.id",""
+                        );
+                        symbols[value] = sym;
+                    }
+                }
+
+                if (!symbols.empty()) {
+                    sym.clear();
+
+                    // for each bit add symbol if it is set;
+                    std::bitset<16> bits (register_block[offset]);
+                    for (unsigned int i = 0; i < 16; i++) {
+                        if (bits[i] && symbols.count (i) == 1) {
+                            sym = sym + symbols[i] + ",";
+                        }
+                    }
+                    if (!sym.empty()) {
+                        sym.pop_back ();  // remove last comma
+                    }
+                    point_map[id] = sym;
+                } else {
+                    point_map[id] = "";
+                }
+            } else if (type == "bitfield32") {
+                std::map <unsigned int, std::string> symbols;
+                std::string sym;
+
+                // collect each bits symbol value
+                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
+                               subtree.get_child("")){
+                    std::string label = subsubtree.first;
+                    if ( label != "<xmlattr>" ) {
+                        pt::ptree symbol = subsubtree.second;
+                        unsigned int value = stoul(symbol.data());
+                        sym = symbol.get <std::string> (
+                            "<xmlattr>.id",""
+                        );
+                        symbols[value] = sym;
+                    }
+                }
+                
+
+                if (!symbols.empty()) {
+                    sym.clear();
+
+                    // for each bit add symbol if it is set;
+                    std::bitset<32> bits (
+                        LegacyModel::GetUINT32(register_block, offset)
+                    );
+                    for (unsigned int i = 0; i < 16; i++) {
+                        if (bits[i] && symbols.count (i) == 1) {
+                            sym = sym + symbols[i] + ",";
+                        }
+                    }
+                    if (!sym.empty()) {
+                        sym.pop_back ();  // remove last comma
+                    }
+                    point_map[id] = sym;
+                } else {
+                    point_map[id] = "";
+                }
+            } else if (type == "sunssf") {
+                int16_t value = register_block[offset];
+                point_map[id] = std::to_string(value);
+            } else if (type == "string") {
+                unsigned int length;
+                length = subtree.get <unsigned int> ("<xmlattr>.len", 0);
+                std::string value = LegacyModel::GetString (
+                    register_block, offset, length
+                );
+                point_map[id] = value;
+            } else if (type == "pad") {
+                //TODO (TS): determine how this value is implemented.
+            } else if (type == "ipaddr") {
+                //TODO (TS): determine how this value is implemented.
+            } else if (type == "ipv6addr") {
+                //TODO (TS): determine how this value is implemented.
+            } else if (type == "eui48") {
+                //TODO (TS): determine how this value is implemented.
+            }
+        }
+    }
+
+    return point_map;
+};
+
+void LegacyModel::GetScalers() {
+    scalers_["default"] = 0;
+     // Traverse property tree
+    BOOST_FOREACH (pt::ptree::value_type const& node,
+                   smdx_.get_child ("sunSpecModels.model.block")) {
+        pt::ptree subtree = node.second;
+        std::string id;
+        unsigned int offset;
+        if( node.first == "point" ) {
+
+            if (subtree.get <std::string> ("<xmlattr>.type") == "sunssf") {
+                id = subtree.get <std::string> ("<xmlattr>.id");
+                offset = subtree.get <int> ("<xmlattr>.offset");
+                scalers_[id] = offset;
+            }
+        }
+    }
+};
+
+float LegacyModel::BlockToScaler (const std::vector <uint16_t>& register_block,
+                                   std::string scaler) {
+    if (std::isdigit (*scaler.c_str())) {
+        return std::stof(scaler);
+    } else if (scaler == "default") {
+        return 1;
+    } else {
+        int16_t sf = register_block[scalers_[scaler]];
+        return std::pow(10, sf);
+    }
+};
+
+uint32_t LegacyModel::GetUINT32 (const std::vector <uint16_t>& block,
+                                  const unsigned int index) {
+    // bitshift the first register 16 bits and then append second register
+    // this process is dependant on modbus
+    return (block[index+1] << 16) | block[index];
+};
+
+std::string LegacyModel::GetString (const std::vector <uint16_t>& block,
+                                     const unsigned int index,
+                                     const unsigned int length) {
+    std::stringstream ss;
+    for (unsigned int i = index; i < length + index; i++) {
+        ss << static_cast <char> (block[i] >> 8);
+        ss << static_cast <char> (block[i]);
+    }
+    return ss.str();
+};
+
+// Time It
+// - run the function for the given iterations and return nanoseconds per call
+template <typename F>
+static double TimeIt (unsigned int iterations, F function) {
+    auto start = std::chrono::steady_clock::now ();
+    for (unsigned int i = 0; i < iterations; i++) {
+        function ();
+    }
+    auto end = std::chrono::steady_clock::now ();
+    std::chrono::duration <double, std::nano> elapsed = end - start;
+    return elapsed.count () / iterations;
+}
+
+// Speedup
+// - format the ratio of the legacy and typed decode times
+static std::string Speedup (double legacy, double typed) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision (1) << legacy / typed << "x";
+    return ss.str ();
+}
+
+int main (int argc, char** argv) {
+    std::string path = (argc > 1) ? argv[1] : "../data/models/smdx/";
+    unsigned int iterations = (argc > 2) ? std::stoul (argv[2]) : 20000;
+    const unsigned int dids[] = {102, 64115, 64201};
+
+    std::mt19937 gen (42);
+    std::uniform_int_distribution <uint16_t> registers (0, 500);
+
+    std::cout << std::left << std::setw (8) << "model"
+        << std::setw (8) << "points"
+        << std::setw (16) << "legacy (ns)"
+        << std::setw (16) << "string (ns)"
+        << std::setw (16) << "typed (ns)"
+        << std::setw (10) << "speedup"
+        << "diff" << std::endl;
+
+    for (const auto did : dids) {
+        std::stringstream ss;
+        ss << path << "smdx_" << std::setfill ('0') << std::setw (5) << did
+            << ".xml";
+
+        LegacyModel legacy_model (ss.str ());
+        SunSpecModel model (did, 0, ss.str ());
+
+        // random block with small scale factors so every point decodes
+        std::vector <uint16_t> block (model.GetLength ());
+        for (auto& reg : block) {
+            reg = registers (gen);
+        }
+        for (const auto& point : model.GetPoints ()) {
+            if (point.type == SunSpecModel::PointType::SUNSSF) {
+                block[point.offset] = static_cast <uint16_t> (-1);
+            }
+        }
+
+        // the string view should match the original decoder point for point
+        std::map <std::string, std::string> legacy_points
+            = legacy_model.BlockToPoints (block);
+        std::map <std::string, std::string> points = model.BlockToPoints (block);
+        unsigned int diff = 0;
+        for (const auto& point : legacy_points) {
+            auto it = points.find (point.first);
+            diff += it == points.end () || it->second != point.second;
+        }
+        for (const auto& point : points) {
+            diff += legacy_points.count (point.first) == 0;
+        }
+
+        std::vector <SunSpecModel::Value> values;
+        volatile float sink = 0;
+        double legacy = TimeIt (iterations, [&]() {
+            sink = legacy_model.BlockToPoints (block).size ();
+        });
+        double strings = TimeIt (iterations, [&]() {
+            sink = model.BlockToPoints (block).size ();
+        });
+        double typed = TimeIt (iterations, [&]() {
+            model.BlockToValues (&block[0], &values);
+            sink = values[0].scaled;
+        });
+        (void)sink;
+
+        std::cout << std::left << std::setw (8) << did
+            << std::setw (8) << model.GetPoints ().size ()
+            << std::setw (16) << legacy
+            << std::setw (16) << strings
+            << std::setw (16) << typed
+            << std::setw (10) << Speedup (legacy, typed)
+            << diff << std::endl;
+    }
+    return 0;
+}
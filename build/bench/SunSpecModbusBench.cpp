@@ -0,0 +1,237 @@
+// Description:
+//      End to end benchmark for the SunSpec modbus path. A Radian is emulated
+//      on the loopback interface with the model chain used by the BESS and a
+//      SunSpecModbus client measures discovery, ReadBlock, ReadValues, the
+//      decode of the block and WritePoint. The throughput and the p50, p90,
+//      p99 and max latency of each operation are reported along with the
+//      number of faults the emulator injected during the operation.
+//
+//      The emulator latency and fault rate can be set to see how the client
+//      behaves with a slow or unreliable device.
+//
+//      Any further arguments are p99 budgets in microseconds, given as the
+//      operation name with underscores for spaces. The benchmark exits with a
+//      failure when an operation is over its budget or the written point does
+//      not read back, so it can be used as a check (make bench_check).
+//
+// Example:
+//      ./bin/bench/sunspec_modbus ../data/models/smdx/ 2000 500 0.01
+//      ./bin/bench/sunspec_modbus ../data/models/smdx/ 2000 0 0 read_block=1000
+
+// INCLUDES
+#include <iostream>
+#include <iomanip>
+#include <streambuf>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdlib>
+#include <dirent.h>
+#include <unistd.h>
+#include "SunSpecEmulator.h"
+#include "SunSpecModbus.h"
+
+// Null Buffer
+// - the modbus client prints every discovered block, the output is dropped
+// - while timing so the terminal does not skew the results
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow (int c) {
+        return c;
+    }
+};
+static NullBuffer null_buffer;
+
+// Remove Directory
+// - remove the files of the temporary cache directory and the directory
+static void RemoveDirectory (const std::string& path) {
+    if (DIR* dir = opendir (path.c_str ())) {
+        while (struct dirent* entry = readdir (dir)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..") {
+                unlink ((path + "/" + name).c_str ());
+            }
+        }
+        closedir (dir);
+    }
+    rmdir (path.c_str ());
+}
+
+// Report
+// - time each call and print the throughput and latency percentiles (us).
+// - The p99 is stored by the operation name with underscores for spaces.
+static void Report (const std::string& name,
+                    unsigned int iterations,
+                    SunSpecEmulator& emulator,
+                    std::function <void ()> function,
+                    std::map <std::string, double>* p99s) {
+    std::vector <double> samples;
+    samples.reserve (iterations);
+    uint64_t faults = emulator.GetStats ().faults;
+
+    std::streambuf* cout_buffer = std::cout.rdbuf (&null_buffer);
+    auto begin = std::chrono::steady_clock::now ();
+    for (unsigned int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now ();
+        function ();
+        std::chrono::duration <double, std::micro> elapsed
+            = std::chrono::steady_clock::now () - start;
+        samples.push_back (elapsed.count ());
+    }
+    std::chrono::duration <double> total
+        = std::chrono::steady_clock::now () - begin;
+    std::cout.rdbuf (cout_buffer);
+
+    std::sort (samples.begin (), samples.end ());
+    auto percentile = [&samples](double p) {
+        return samples[std::min (samples.size () - 1,
+            static_cast <size_t> (p * samples.size ()))];
+    };
+    std::cout << std::left << std::setw (18) << name
+        << std::right << std::fixed << std::setprecision (1)
+        << std::setw (8) << iterations
+        << std::setw (12) << iterations / total.count ()
+        << std::setw (10) << percentile (0.5)
+        << std::setw (10) << percentile (0.9)
+        << std::setw (10) << percentile (0.99)
+        << std::setw (10) << samples.back ()
+        << std::setw (8) << emulator.GetStats ().faults - faults << std::endl;
+
+    std::string key = name;
+    std::replace (key.begin (), key.end (), ' ', '_');
+    (*p99s)[key] = percentile (0.99);
+}
+
+int main (int argc, char** argv) {
+    std::string path = (argc > 1) ? argv[1] : "../data/models/smdx/";
+    unsigned int iterations = (argc > 2) ? std::stoul (argv[2]) : 2000;
+    std::string latency = (argc > 3) ? argv[3] : "0";
+    std::string fault_rate = (argc > 4) ? argv[4] : "0";
+    unsigned int discoveries = std::max (1u, iterations / 20);
+
+    std::map <std::string, double> budgets;
+    for (int i = 5; i < argc; i++) {
+        std::string budget = argv[i];
+        size_t equals = budget.find ('=');
+        if (equals == std::string::npos) {
+            std::cout << "[ERROR]\t" << "budget is not operation=us: " << budget
+                << '\n';
+            return EXIT_FAILURE;
+        }
+        budgets[budget.substr (0, equals)]
+            = std::stod (budget.substr (equals + 1));
+    }
+    std::map <std::string, double> p99s;
+
+    std::map <std::string, std::string> device;
+    device["path"] = path;
+    device["port"] = "15020";
+    device["models"] = "1,102,64115,64116,64120";
+    device["latency"] = latency;
+    device["fault_rate"] = fault_rate;
+    std::streambuf* cout_buffer = std::cout.rdbuf (&null_buffer);
+    SunSpecEmulator emulator (device);
+    std::cout.rdbuf (cout_buffer);
+    if (!emulator.Start ()) {
+        return EXIT_FAILURE;
+    }
+
+    // the same settings as the [Radian] section without the discovery pause
+    std::map <std::string, std::string> client;
+    client["key"] = "1850954613";
+    client["did"] = "1";
+    client["path"] = path;
+    client["ip"] = "127.0.0.1";
+    client["port"] = device["port"];
+    client["max_write"] = "123";
+    client["query_delay"] = "0";
+
+    std::cout << std::left << std::setw (18) << "operation"
+        << std::right
+        << std::setw (8) << "count"
+        << std::setw (12) << "ops/s"
+        << std::setw (10) << "p50 (us)"
+        << std::setw (10) << "p90 (us)"
+        << std::setw (10) << "p99 (us)"
+        << std::setw (10) << "max (us)"
+        << std::setw (8) << "faults" << std::endl;
+
+    Report ("discovery", discoveries, emulator, [&client]() {
+        SunSpecModbus modbus (client);
+    }, &p99s);
+
+    char cache[] = "/tmp/sunspec_cache_XXXXXX";
+    if (mkdtemp (cache)) {
+        std::map <std::string, std::string> cached = client;
+        cached["cache"] = std::string (cache) + "/";
+        std::cout.rdbuf (&null_buffer);
+        { SunSpecModbus warm (cached); }
+        std::cout.rdbuf (cout_buffer);
+        Report ("discovery cached", discoveries, emulator, [&cached]() {
+            SunSpecModbus modbus (cached);
+        }, &p99s);
+        RemoveDirectory (cache);
+    }
+
+    std::cout.rdbuf (&null_buffer);
+    SunSpecModbus modbus (client);
+    std::cout.rdbuf (cout_buffer);
+    std::shared_ptr <SunSpecModel> model = modbus.GetModel (64115);
+    if (!model) {
+        std::cout << "[ERROR]\t" << "model 64115 was not discovered\n";
+        return EXIT_FAILURE;
+    }
+    std::vector <uint16_t> block (model->GetLength ());
+    std::vector <SunSpecModel::Value> values;
+
+    Report ("read registers", iterations, emulator, [&]() {
+        modbus.ReadRegisters (model->GetOffset (), block.size (), &block[0]);
+    }, &p99s);
+    Report ("read block", iterations, emulator, [&]() {
+        modbus.ReadBlock (64115);
+    }, &p99s);
+    Report ("read values", iterations, emulator, [&]() {
+        modbus.ReadValues (64115, &values);
+    }, &p99s);
+    Report ("decode", iterations, emulator, [&]() {
+        model->BlockToValues (&block[0], &values);
+    }, &p99s);
+
+    std::map <std::string, std::string> point;
+    point["GSconfig_Charger_AC_Input_Current_Limit"] = "30";
+    Report ("write point", iterations, emulator, [&]() {
+        modbus.WritePoint (64116, point);
+    }, &p99s);
+
+    // the written value should read back when no faults are injected
+    std::shared_ptr <SunSpecModel> config = modbus.GetModel (64116);
+    int index = config->GetIndex ("GSconfig_Charger_AC_Input_Current_Limit");
+    uint16_t written = (index < 0) ? 0 : emulator.GetRegister (
+        config->GetOffset () + config->GetPoints ()[index].offset
+    );
+    bool failed = false;
+    if (index < 0 || (std::stof (fault_rate) == 0 && written != 30)) {
+        std::cout << "[ERROR]\t" << "write point read back " << written
+            << '\n';
+        failed = true;
+    }
+
+    for (const auto& budget : budgets) {
+        if (p99s.count (budget.first) == 0) {
+            std::cout << "[ERROR]\t" << "no operation named " << budget.first
+                << '\n';
+            failed = true;
+        } else if (p99s[budget.first] > budget.second) {
+            std::cout << "[ERROR]\t" << budget.first << " p99 "
+                << p99s[budget.first] << " us is over the " << budget.second
+                << " us budget\n";
+            failed = true;
+        }
+    }
+
+    emulator.Stop ();
+    return failed ? EXIT_FAILURE : 0;
+}
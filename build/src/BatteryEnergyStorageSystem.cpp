@@ -2,37 +2,72 @@
 #include <iostream>
 #include <ctime>
 #include "include/BatteryEnergyStorageSystem.h"
+#include "include/Scheduler.h"
 #include "include/logger.h"
 
+// Scaled
+// - get the scaled value of a compiled point or zero if the point was not
+// - found in the model or the block was not read.
+static float Scaled (const std::vector <SunSpecModel::Value>& values,
+                     int index) {
+	if (index < 0 || static_cast <unsigned int> (index) >= values.size ()) {
+		return 0;
+	}
+	return values[index].scaled;
+}
+
 // Constructor
 BatteryEnergyStorageSystem::BatteryEnergyStorageSystem (
 	tsu::config_map& map) : 
 	inverter_(map["Radian"]),
 	bms_(map["BMS"]),
-	last_control_(0),
-	last_log_(0) {
+	inverter_poller_(&inverter_),
+	bms_poller_(&bms_),
+	split_vac_(0),
+	bms_faults_(0),
+	bms_warnings_(0),
+	radian_events_(0),
+	last_log_(0),
+	last_control_(0) {
 	// start constructor
 	SetLogPath (map["BESS"]["log_path"]);
 	SetLogIncrement (stoul(map["BESS"]["log_inc"]));
+	SetLogBinary (map["BESS"]["log_format"] == "binary");
 
 	// set rated properties and query for dynamic properties
 	BatteryEnergyStorageSystem::GetRatedProperties ();
+	BatteryEnergyStorageSystem::SubscribePoints ();
+
+	// the first poll is done here so the snapshot is populated before the
+	// polling threads take over
+	inverter_poller_.Poll ();
+	bms_poller_.Poll ();
 	BatteryEnergyStorageSystem::Query ();
 	BatteryEnergyStorageSystem::SetRadianConfigurations ();
+	inverter_poller_.Start ();
+	bms_poller_.Start ();
 };
 
 // Destructor
+// - the pollers are stopped first so the resets are written directly and any
+// - queued control writes are sent before them
 BatteryEnergyStorageSystem::~BatteryEnergyStorageSystem () {
+	inverter_poller_.Stop ();
+	bms_poller_.Stop ();
 	block_map point;
 
 	// reset charge current to default
 	point ["GSconfig_Charger_AC_Input_Current_Limit"] = "30";
-	inverter_.WritePoint (64116, point);
+	if (!inverter_.WritePoint (64116, point)) {
+		Logger ("ERROR", GetLogPath ()) << "Destructor: charge current not reset";
+	}
 	point.clear();
 
 	// reset sell current to default
 	point ["OB_Set_Radian_Inverter_Sell_Current_Limit"] = "30";
-	inverter_.WritePoint (64120, point);
+	if (!inverter_.WritePoint (64120, point)) {
+		Logger ("ERROR", GetLogPath ()) << "Destructor: sell current not reset";
+	}
 	point.clear();
 };
 
@@ -45,27 +80,49 @@ void BatteryEnergyStorageSystem::Loop (float delta_time){
 
 	unsigned int utc = time (0);
 	bool five_seconds = (utc % 5 == 0);  // the inverter is slow to process 
-	bool one_minute = (utc % 60 == 0);	 // logging once a minute should be fine
+	bool log_time = (utc % GetLogIncrement () == 0);
 
 	// the frequency bool must be checked with the last control/log because the
 	// main thread freqency is 0.5 seconds which leads to 2ish calls per second
 	if (five_seconds && utc != last_control_) {
 		last_control_ = utc;
-		BatteryEnergyStorageSystem::Query ();
-		if (GetImportWatts () > 0) {
-			BatteryEnergyStorageSystem::ImportPower ();
-		} else if (GetExportWatts () > 0) {
-			BatteryEnergyStorageSystem::ExportPower ();
-		} else {
-			BatteryEnergyStorageSystem::Idleloss ();
-		}
+		BatteryEnergyStorageSystem::Control ();
 	}
-	if (one_minute && utc != last_log_) {
+	if (log_time && utc != last_log_) {
 		last_log_ = utc;
 		BatteryEnergyStorageSystem::Log ();
 	}
 };  // end Loop
 
+// Schedule
+// - control and logging are registered as their own tasks so they run on the
+// - exact wall clock slots instead of being polled by the loop. The period of
+// - the loop is not used since there is nothing else to do between slots.
+void BatteryEnergyStorageSystem::Schedule (Scheduler* scheduler,
+                                           unsigned int period_ms) {
+	(void)period_ms;
+	scheduler->AddTask ("BESS Control", [this]() {
+		BatteryEnergyStorageSystem::Control ();
+	}, kControlMilliseconds);
+	scheduler->AddTask ("BESS Log", [this]() {
+		BatteryEnergyStorageSystem::Log ();
+	}, GetLogIncrement () * 1000);
+};  // end Schedule
+
+// Control
+// - query the devices and then update the control for the setpoint
+void BatteryEnergyStorageSystem::Control () {
+	std::lock_guard <std::mutex> lock (control_mutex_);
+	BatteryEnergyStorageSystem::Query ();
+	if (GetImportWatts () > 0) {
+		BatteryEnergyStorageSystem::ImportPower ();
+	} else if (GetExportWatts () > 0) {
+		BatteryEnergyStorageSystem::ExportPower ();
+	} else {
+		BatteryEnergyStorageSystem::IdleLoss ();
+	}
+};  // end Control
+
 // Display
 void BatteryEnergyStorageSystem::Display (){
 	std::cout << "[Properties]"
@@ -81,102 +138,128 @@ void BatteryEnergyStorageSystem::Display (){
 // Import Power
 // - check the mode and if it is not charging then set the required registers
 // - for a charge. Then calculate the required current setting for the control
-// - watts.
+// - watts. The points of each model are queued as a single transaction on
+// - the poller and the controls are dropped if the configs fail, the next
+// - control cycle will try again since the mode is read back from the radian.
 void BatteryEnergyStorageSystem::ImportPower () {
-	block_map point;
+	block_map configs;   // 64116
+	block_map controls;  // 64120
 	std::cout << "MODE: " << radian_mode_ << std::endl;
 	if (radian_mode_ != "CHARGING") {
-		// each point must be created, written, then cleared
-		point ["GSconfig_Sell_Volts"] = "64";
-		inverter_.WritePoint (64116, point);
-		point.clear();
-
-		point ["GSconfig_Charger_Operating_Mode"] 
+		configs ["GSconfig_Sell_Volts"] = "64";
+		configs ["GSconfig_Charger_Operating_Mode"] 
 			= "BULK_AND_FLOAT_CHARGING_ENABLED";
-		inverter_.WritePoint (64116, point);
-		point.clear();
-
-		point ["OB_Bulk_Charge_Enable_Disable"] = "START_BULK";
-		inverter_.WritePoint (64120, point);
-		point.clear();
+		controls ["OB_Bulk_Charge_Enable_Disable"] = "START_BULK";
 	}
 
 	unsigned int real_watts = GetImportPower ();
 	unsigned int control_watts = GetImportWatts ();
-	if (real_watts > 1.1*control_watts || real_watts < 0.9*control_watts) {
+	if (split_vac_ > 0
+		&& (real_watts > 1.1*control_watts || real_watts < 0.9*control_watts)) {
 		float current_limit = GetImportWatts () / split_vac_;
-		point ["GSconfig_Charger_AC_Input_Current_Limit"] 
+		configs ["GSconfig_Charger_AC_Input_Current_Limit"] 
 			= std::to_string (current_limit);
-		inverter_.WritePoint (64116, point);
-		point.clear();
+	}
+
+	if (!configs.empty () && !inverter_poller_.WritePoints (64116, configs)) {
+		Logger ("ERROR", GetLogPath ()) << "Import Power: config write failed";
+		return;
+	}
+	if (!controls.empty () && !inverter_poller_.WritePoints (64120, controls)) {
+		Logger ("ERROR", GetLogPath ()) << "Import Power: control write failed";
 	}
 };  // end Import Power
 
 // Export Power
 // - check the mode and if it is not selling then set the required registers
 // - for a discharge. Then calculate the required current setting for the
-// - control watts.
+// - control watts. The controls are dropped if the configs fail.
 void BatteryEnergyStorageSystem::ExportPower () {
-	block_map point;
+	block_map configs;   // 64116
+	block_map controls;  // 64120
 	if (radian_mode_ != "SELLING") {
-		// each point must be created, written, then cleared
-		point ["GSconfig_Charger_Operating_Mode"] 
+		configs ["GSconfig_Charger_Operating_Mode"] 
 			= "ALL_INVERTER_CHARGING_DISABLED";
-		inverter_.WritePoint (64116, point);
-		point.clear();
-
-		point ["GSconfig_Sell_Volts"] = "44";
-		inverter_.WritePoint (64116, point);
-		point.clear();
+		configs ["GSconfig_Sell_Volts"] = "44";
 	}
 
 	unsigned int real_watts = GetExportPower ();
 	unsigned int control_watts = GetExportWatts ();
-	if (real_watts > 1.1*control_watts || real_watts < 0.9*control_watts) {
+	if (split_vac_ > 0
+		&& (real_watts > 1.1*control_watts || real_watts < 0.9*control_watts)) {
 		float current_limit = GetImportWatts () / split_vac_;
-		point ["OB_Set_Radian_Inverter_Sell_Current_Limit"] 
+		controls ["OB_Set_Radian_Inverter_Sell_Current_Limit"] 
 			= std::to_string (current_limit);
-		inverter_.WritePoint (64120, point);
-		point.clear();
+	}
+
+	if (!configs.empty () && !inverter_poller_.WritePoints (64116, configs)) {
+		Logger ("ERROR", GetLogPath ()) << "Export Power: config write failed";
+		return;
+	}
+	if (!controls.empty () && !inverter_poller_.WritePoints (64120, controls)) {
+		Logger ("ERROR", GetLogPath ()) << "Export Power: control write failed";
 	}
 };  // end Export Power
 
 // Idle Loss
 // - This function disables both importing from and exporting to the grid
 void BatteryEnergyStorageSystem::IdleLoss (){
-	block_map point;
+	block_map configs;  // 64116
 	if (radian_mode_ == "CHARGING" || radian_mode_ == "SELLING") {
-		// each point must be created, written, then cleared
-		point ["GSconfig_Charger_Operating_Mode"] 
+		configs ["GSconfig_Charger_Operating_Mode"] 
 			= "ALL_INVERTER_CHARGING_DISABLED";
-		inverter_.WritePoint (64116, point);
-		point.clear();
-
-		point ["GSconfig_Sell_Volts"] 
-			= "64";
-		inverter_.WritePoint (64116, point);
-		point.clear();
+		configs ["GSconfig_Sell_Volts"] = "64";
+		if (!inverter_poller_.WritePoints (64116, configs)) {
+			Logger ("ERROR", GetLogPath ()) << "Idle Loss: config write failed";
+		}
 	}
 };  // end Idle Loss
 
 // Log
+// - the radian mode is logged as its enum value in binary telemetry
 void BatteryEnergyStorageSystem::Log () {
+	std::lock_guard <std::mutex> lock (control_mutex_);
+	if (GetLogBinary ()) {
+		float mode = -1;
+		if (index_.mode >= 0
+			&& static_cast <unsigned int> (index_.mode) < split_values_.size ()) {
+			mode = split_values_[index_.mode].raw;
+		}
+		Telemetry ("DATA", GetLogPath (),
+		           "export_watts,export_power,export_energy,"
+		           "import_watts,import_power,import_energy,mode")
+			<< GetExportWatts ()
+			<< GetExportPower ()
+			<< GetRatedExportEnergy ()
+			<< GetImportWatts ()
+			<< GetImportPower ()
+			<< GetRatedImportEnergy ()
+			<< mode;
+		return;
+	}
 	Logger ("DATA", GetLogPath ()) 
-		<< "E: W, P, E, I: W, P, E, M"
-		<< GetExportWatts ()
-		<< GetExportPower ()
-		<< GetRatedExportEnergy ()
-		<< GetImportWatts ()
-		<< GetImportPower ()
-		<< GetRatedImportEnergy ()
+		<< "E: W, P, E, I: W, P, E, M\t"
+		<< GetExportWatts () << "\t"
+		<< GetExportPower () << "\t"
+		<< GetRatedExportEnergy () << "\t"
+		<< GetImportWatts () << "\t"
+		<< GetImportPower () << "\t"
+		<< GetRatedImportEnergy () << "\t"
 		<< radian_mode_;
 };  // end Log
 
 // Get Rated Properties
 // - read specific device information an update member properties
+// - this is only called by the constructor before the pollers are started, so
+// - the blocking reads never delay the control loop.
 void BatteryEnergyStorageSystem::GetRatedProperties () {
 	block_map radian_configs = inverter_.ReadBlock (64116);
 	block_map aquion_bms = bms_.ReadBlock (64201);
+	if (radian_configs.empty () || aquion_bms.empty ()) {
+		// the rated properties are left as they were
+		std::cout << "[ERROR]\t" << "Get Rated Properties: read failed\n";
+		return;
+	}
 
 	// radian power and energy properties
 	float rated_ac_amps 
@@ -205,20 +288,29 @@ void BatteryEnergyStorageSystem::GetRatedProperties () {
 
 // Query
 // - read specific device information an update member properties
+// - the values come from the pollers latest snapshot, so no modbus I/O is done
+// - by the control thread.
 void BatteryEnergyStorageSystem::Query () {
-	block_map ss_inverter = inverter_.ReadBlock (102);
-	block_map radian_split = inverter_.ReadBlock (64115);
-	block_map aquion_bms = bms_.ReadBlock (64201);
+	inverter_poller_.ReadValues (102, &sunspec_values_);
+	inverter_poller_.ReadValues (64115, &split_values_, &split_ages_);
+	bms_poller_.ReadValues (64201, &bms_values_);
+
+	// warn when the inverter has stopped responding to the poller
+	if (index_.buy_kw >= 0 && !split_ages_.empty ()
+		&& split_ages_[index_.buy_kw] > kStaleMilliseconds) {
+		std::cout << "[WARNING]\t" << "Radian values are stale: " 
+			<< split_ages_[index_.buy_kw] << " ms" << std::endl;
+	}
 
 	// update error/warning/event properties
-	BatteryEnergyStorageSystem::CheckBMSErrors (aquion_bms);
-	BatteryEnergyStorageSystem::CheckRadianErrors (ss_inverter);
+	BatteryEnergyStorageSystem::CheckBMSErrors ();
+	BatteryEnergyStorageSystem::CheckRadianErrors ();
 
 	// sunspec power and energy properties
-	float ac_amps = stof (ss_inverter["A"]);
-	float ac_volts = stof (ss_inverter["PPVphAB"]);
-	float ac_watts = stof (ss_inverter["W"]);
-	float dc_volts = stof (ss_inverter["DCV"]);
+	float ac_amps = Scaled (sunspec_values_, index_.ac_amps);
+	float ac_volts = Scaled (sunspec_values_, index_.ac_volts);
+	float ac_watts = Scaled (sunspec_values_, index_.ac_watts);
+	float dc_volts = Scaled (sunspec_values_, index_.dc_volts);
 
 	std::cout << "DEBUG (sunspec values):"
 		<< "\n\tAac: " << ac_amps
@@ -227,20 +319,20 @@ void BatteryEnergyStorageSystem::Query () {
 		<< "\n\tVdc: " << dc_volts << std::endl;
 
 	// radian power and energy properties
-	float acl1_buy_amps 
-		= stof (radian_split["GS_Split_L1_Inverter_Buy_Current"]);
-	float acl2_buy_amps 
-		= stof (radian_split["GS_Split_L2_Inverter_Buy_Current"]);
-	float acl1_sell_amps 
-		= stof (radian_split["GS_Split_L1_Inverter_Sell_Current"]);
-	float acl2_sell_amps 
-		= stof (radian_split["GS_Split_L2_Inverter_Sell_Current"]);
-	float output_watts = stof (radian_split["GS_Split_Output_kW"]) * 1000;
-	float buy_watts = stof (radian_split["GS_Split_Buy_kW"]) * 1000;
-	float sell_watts = stof (radian_split["GS_Split_Sell_kW"]) * 1000;
-	float charge_watts = stof (radian_split["GS_Split_Charge_kW"]) * 1000;
-	float load_watts = stof (radian_split["GS_Split_Load_kW"]) * 1000;
-	radian_mode_ = radian_split["GS_Split_Inverter_Operating_mode"];
+	float acl1_buy_amps = Scaled (split_values_, index_.l1_buy_amps);
+	float acl2_buy_amps = Scaled (split_values_, index_.l2_buy_amps);
+	float acl1_sell_amps = Scaled (split_values_, index_.l1_sell_amps);
+	float acl2_sell_amps = Scaled (split_values_, index_.l2_sell_amps);
+	float output_watts = Scaled (split_values_, index_.output_kw) * 1000;
+	float buy_watts = Scaled (split_values_, index_.buy_kw) * 1000;
+	float sell_watts = Scaled (split_values_, index_.sell_kw) * 1000;
+	float charge_watts = Scaled (split_values_, index_.charge_kw) * 1000;
+	float load_watts = Scaled (split_values_, index_.load_kw) * 1000;
+	if (split_model_ && index_.mode >= 0 && !split_values_.empty ()) {
+		radian_mode_ = split_model_->ValueToSymbol (
+			index_.mode, split_values_[index_.mode]
+		);
+	}
 
 	std::cout << "DEBUG (radian values):"
 		<< "\n\tL1 buy Aac: " << acl1_buy_amps
@@ -254,7 +346,7 @@ void BatteryEnergyStorageSystem::Query () {
 		<< "\n\tload watts: " << load_watts << std::endl;
 
 	// bms power and energy properties
-	float soc = stof (aquion_bms["soc"]) / 100;
+	float soc = Scaled (bms_values_, index_.soc) / 100;
 
 	// set DER properties
 	SetImportPower (buy_watts);
@@ -266,90 +358,124 @@ void BatteryEnergyStorageSystem::Query () {
 
 };  // end Query
 
+// Subscribe Points
+// - resolve the points used by Query once so each query only indexes the
+// - typed values. Points that are not found are stored as -1. Each point is
+// - subscribed to its poller so only these registers are read.
+void BatteryEnergyStorageSystem::SubscribePoints () {
+	sunspec_model_ = inverter_.GetModel (102);
+	split_model_ = inverter_.GetModel (64115);
+	bms_model_ = bms_.GetModel (64201);
+
+	auto find = [](SunSpecPoller& poller,
+				   std::shared_ptr <SunSpecModel>& model,
+				   const char* id,
+				   unsigned int interval_ms) {
+		if (!model || !poller.Subscribe (model->did_, id, interval_ms)) {
+			return -1;
+		}
+		return model->GetIndex (id);
+	};
+
+	// power and mode are used by every control cycle
+	SunSpecPoller& inv = inverter_poller_;
+	index_.ac_amps = find (inv, sunspec_model_, "A", 1000);
+	index_.ac_volts = find (inv, sunspec_model_, "PPVphAB", 1000);
+	index_.ac_watts = find (inv, sunspec_model_, "W", 1000);
+	index_.dc_volts = find (inv, sunspec_model_, "DCV", 1000);
+	index_.events = find (inv, sunspec_model_, "Evt1", 5000);
+	index_.l1_buy_amps 
+		= find (inv, split_model_, "GS_Split_L1_Inverter_Buy_Current", 1000);
+	index_.l2_buy_amps 
+		= find (inv, split_model_, "GS_Split_L2_Inverter_Buy_Current", 1000);
+	index_.l1_sell_amps 
+		= find (inv, split_model_, "GS_Split_L1_Inverter_Sell_Current", 1000);
+	index_.l2_sell_amps 
+		= find (inv, split_model_, "GS_Split_L2_Inverter_Sell_Current", 1000);
+	index_.output_kw = find (inv, split_model_, "GS_Split_Output_kW", 1000);
+	index_.buy_kw = find (inv, split_model_, "GS_Split_Buy_kW", 1000);
+	index_.sell_kw = find (inv, split_model_, "GS_Split_Sell_kW", 1000);
+	index_.charge_kw = find (inv, split_model_, "GS_Split_Charge_kW", 1000);
+	index_.load_kw = find (inv, split_model_, "GS_Split_Load_kW", 1000);
+	index_.mode 
+		= find (inv, split_model_, "GS_Split_Inverter_Operating_mode", 1000);
+
+	// the battery state changes slowly
+	index_.soc = find (bms_poller_, bms_model_, "soc", 5000);
+	index_.faults = find (bms_poller_, bms_model_, "fault_code", 5000);
+	index_.warnings = find (bms_poller_, bms_model_, "warning_code", 5000);
+};  // end Subscribe Points
+
 
 // Set Radian Configurations
 // - sets the battery charge profile and inverter charge configs at the start
 // - of the program. Most of the values will not be changed after initialization
 void BatteryEnergyStorageSystem::SetRadianConfigurations () {
-	// each point must be created, written, then cleared
-	block_map point;
+	// all points are written as one transaction so adjacent registers are
+	// combined into block writes
+	block_map configs;
 
 	// OutBack has ranges fore most config registers found in Table 16 of the
 	// manual.
-	point ["GSconfig_Absorb_Volts"] = "57.6";  // range: 44 to 64 volts
-	inverter_.WritePoint (64116, point);
-
-	point ["GSconfig_Absorb_Time_Hours"] = "10";  // range: 0 to 24 hours
-	inverter_.WritePoint (64116, point);
-	point.clear();
-
-	point ["GSconfig_Float_Volts"] = "54.4";  // range: 44 to 64 volts
-	inverter_.WritePoint (64116, point);
-	point.clear();
-
-	point ["GSconfig_Float_Time_Hours"] = "10";  // range: 0 to 24/7 hours
-	inverter_.WritePoint (64116, point);
-	point.clear();
-
-	point ["GSconfig_ReFloat_Volts"] = "44";  // range: 44 to 64 volts
-	inverter_.WritePoint (64116, point);
-	point.clear();
-
-	point ["GSconfig_Sell_Volts"] = "64";  // range: 44 to 64 volts
-	inverter_.WritePoint (64116, point);
-	point.clear();
-
-	point ["GSconfig_Low_Battery_Cut_Out_Voltage"] = "64";  // range: 36 to 48
-	inverter_.WritePoint (64116, point);
-	point.clear();
-	
-	point ["GSconfig_Low_Battery_Cut_In_Voltage"] = "64";  // range: 40 - 56
-	inverter_.WritePoint (64116, point);
-	point.clear();
-
-	point ["GSconfig_Charger_AC_Input_Current_Limit"] = "30";  // range: 0 - 30
-	inverter_.WritePoint (64116, point);
-	point.clear();
-
-	point ["GSconfig_Charger_Operating_Mode"] 
+	configs ["GSconfig_Absorb_Volts"] = "57.6";  // range: 44 to 64 volts
+	configs ["GSconfig_Absorb_Time_Hours"] = "10";  // range: 0 to 24 hours
+	configs ["GSconfig_Float_Volts"] = "54.4";  // range: 44 to 64 volts
+	configs ["GSconfig_Float_Time_Hours"] = "10";  // range: 0 to 24/7 hours
+	configs ["GSconfig_ReFloat_Volts"] = "44";  // range: 44 to 64 volts
+	configs ["GSconfig_Sell_Volts"] = "64";  // range: 44 to 64 volts
+	configs ["GSconfig_Low_Battery_Cut_Out_Voltage"] = "64";  // range: 36 to 48
+	configs ["GSconfig_Low_Battery_Cut_In_Voltage"] = "64";  // range: 40 - 56
+	configs ["GSconfig_Charger_AC_Input_Current_Limit"] = "30";  // range: 0 - 30
+	configs ["GSconfig_Charger_Operating_Mode"] 
 		= "ALL_INVERTER_CHARGING_DISABLED";
-	inverter_.WritePoint (64116, point);
-	point.clear();
-
-	point ["GSconfig_Module_Control"] = "BOTH";
-	inverter_.WritePoint (64116, point);
-	point.clear();
-
-	point ["GSconfig_Model_Select"] = "FULL";
-	inverter_.WritePoint (64116, point);
-	point.clear();
-
-	point ["GSconfig_Grid_Tie_Enable"] = "YES";
-	inverter_.WritePoint (64116, point);
-	point.clear();
+	configs ["GSconfig_Module_Control"] = "BOTH";
+	configs ["GSconfig_Model_Select"] = "FULL";
+	configs ["GSconfig_Grid_Tie_Enable"] = "YES";
+	if (!inverter_.WritePoints (64116, configs)) {
+		Logger ("ERROR", GetLogPath ()) 
+			<< "Set Radian Configurations: config write failed";
+	}
 };  // end Set Radian Configurations
 
 // Check BMS Errors
 // - check the current fault/warning codes agains previous and if they are the
 // - same then do not log again.
-void BatteryEnergyStorageSystem::CheckBMSErrors (block_map& block) {
-	if (block["fault_code"] != bms_faults_) {
-		bms_faults_ = block["fault_code"];
-		Logger ("ERROR", GetLogPath ()) << "BMS Fault:" << bms_faults_;
+void BatteryEnergyStorageSystem::CheckBMSErrors () {
+	if (!bms_model_ || bms_values_.empty ()) {
+		return;
 	}
 
-	if (block["warning_code"] != bms_warnings_) {
-		bms_warnings_ = block["fault_code"];
-		Logger ("ERROR", GetLogPath ()) << "BMS Warning:" << bms_warnings_;
+	if (index_.faults >= 0 && bms_values_[index_.faults].raw != bms_faults_) {
+		bms_faults_ = bms_values_[index_.faults].raw;
+		Logger ("ERROR", GetLogPath ()) << "BMS Fault:" 
+			<< bms_model_->ValueToString (
+				index_.faults, bms_values_[index_.faults]
+			);
+	}
+
+	if (index_.warnings >= 0 
+		&& bms_values_[index_.warnings].raw != bms_warnings_) {
+		bms_warnings_ = bms_values_[index_.warnings].raw;
+		Logger ("ERROR", GetLogPath ()) << "BMS Warning:" 
+			<< bms_model_->ValueToString (
+				index_.warnings, bms_values_[index_.warnings]
+			);
 	}
 };  // end Check BMS Errors
 
 // Check Radian Errors
 // - check the current fault/warning codes against previous and if they are the
 // - same the do not log again.
-void BatteryEnergyStorageSystem::CheckRadianErrors (block_map& block) {
-	if (block["Evt1"] != radian_events_) {
-		radian_events_ = block["Evt1"];
-		Logger ("ERROR", GetLogPath ()) << "Radian Event:" << radian_events_;
+void BatteryEnergyStorageSystem::CheckRadianErrors () {
+	if (!sunspec_model_ || sunspec_values_.empty () || index_.events < 0) {
+		return;
+	}
+
+	if (sunspec_values_[index_.events].raw != radian_events_) {
+		radian_events_ = sunspec_values_[index_.events].raw;
+		Logger ("ERROR", GetLogPath ()) << "Radian Event:" 
+			<< sunspec_model_->ValueToString (
+				index_.events, sunspec_values_[index_.events]
+			);
 	}
-};  // end Check Radian Errors
\ No newline at end of file
+};  // end Check Radian Errors
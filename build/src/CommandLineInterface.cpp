@@ -7,7 +7,8 @@
 bool scheduled;  // this variable is a global from main
 
 CommandLineInterface::CommandLineInterface (
-	DistributedEnergyResource* der_ptr) : der_ptr_(der_ptr) {
+	DistributedEnergyResource* der_ptr, Scheduler* scheduler_ptr) 
+	: der_ptr_(der_ptr), scheduler_ptr_(scheduler_ptr) {
 }  // end constructor
 
 CommandLineInterface::~CommandLineInterface () {
@@ -23,7 +24,8 @@ void CommandLineInterface::Help () {
         << "> o <y/n>      operator enable/disable\n"
         << "> i <watts>    import power\n"
         << "> e <watts>    export power\n"
-        << "> d            display properties\n";
+        << "> d            display properties\n"
+        << "> s            display scheduler tasks\n";
 } // end Help
 
 // Command Line Interface
@@ -88,6 +90,13 @@ bool CommandLineInterface::Control (const std::string& input) {
             break;
         }
 
+        case 's': {
+            if (scheduler_ptr_ != nullptr) {
+                scheduler_ptr_->Display ();
+            }
+            break;
+        }
+
         default: {
             CommandLineInterface::Help ();
             break;
@@ -2,7 +2,10 @@
 #include <iostream>
 #include <random>
 #include <ctime>
+#include <chrono>
+#include <memory>
 #include "include/DistributedEnergyResource.h"
+#include "include/Scheduler.h"
 #include "include/logger.h"
 
 // This constructor is to be used by child classes since they will populate
@@ -20,7 +23,8 @@ DistributedEnergyResource::DistributedEnergyResource () :
     export_watts_(0),
     import_watts_(0),
     delta_time_(0),
-    last_utc_(0) {
+    last_utc_(0),
+    log_binary_(false) {
     // do nothing
 }  // end constructor
 
@@ -41,7 +45,8 @@ DistributedEnergyResource::DistributedEnergyResource (
     delta_time_(0),
     last_utc_(0),
     log_inc_(stoul(init["log_inc"])),
-    log_path_(init["log_path"]) {
+    log_path_(init["log_path"]),
+    log_binary_(init["log_format"] == "binary") {
 
     // randomly assign energy capacity based on normal distripution
     // - reference: 
@@ -206,6 +211,12 @@ void DistributedEnergyResource::SetLogIncrement (unsigned int inc) {
     log_inc_ = inc;
 }  // end Set Log Increment
 
+// Set Log Binary
+// - log data as binary columnar telemetry instead of text
+void DistributedEnergyResource::SetLogBinary (bool binary) {
+    log_binary_ = binary;
+}  // end Set Log Binary
+
 // Get Rated Export Watts
 // - get the control watt value available to export to the grid
 unsigned int DistributedEnergyResource::GetExportWatts () {
@@ -294,6 +305,17 @@ std::string DistributedEnergyResource::GetLogPath () {
     return log_path_;
 }  // end Get Log Path
 
+// Get Log Increment
+// - return the seconds between logging
+unsigned int DistributedEnergyResource::GetLogIncrement () {
+    return log_inc_;
+}  // end Get Log Increment
+
+// Get Log Binary
+bool DistributedEnergyResource::GetLogBinary () {
+    return log_binary_;
+}  // end Get Log Binary
+
 // Get Remote Time
 // - not sure if this will be required by others, but it is an accessor
 unsigned int DistributedEnergyResource::GetRemoteTime () {
@@ -394,6 +416,19 @@ void DistributedEnergyResource::IdleLoss () {
 void DistributedEnergyResource::Log () {
     unsigned int utc = time (0);
     if (utc % log_inc_ == 0 && last_utc_ != utc){
+        last_utc_ = utc;
+        if (log_binary_) {
+            Telemetry ("DER_Data", log_path_,
+                       "import_watts,import_power,import_energy,"
+                       "export_watts,export_power,export_energy")
+                << import_watts_
+                << import_power_
+                << import_energy_
+                << export_watts_
+                << export_power_
+                << export_energy_;
+            return;
+        }
         Logger ("DER_Data", log_path_)
             << import_watts_ << "\t"
             << import_power_ << "\t"
@@ -401,7 +436,6 @@ void DistributedEnergyResource::Log () {
             << export_watts_ << "\t"
             << export_power_ << "\t"
             << export_energy_ << "\t";
-        last_utc_ = utc;
     }
 }  // end Log
 
@@ -420,6 +454,22 @@ void DistributedEnergyResource::Loop (float delta_time) {
     DistributedEnergyResource::Log ();
 }  // end Control
 
+// Schedule
+// - register the loop as a periodic task. The delta time passed to the loop is
+// - measured from the start of the last run.
+void DistributedEnergyResource::Schedule (Scheduler* scheduler,
+                                          unsigned int period_ms) {
+    auto last = std::make_shared <std::chrono::steady_clock::time_point> (
+        std::chrono::steady_clock::now ()
+    );
+    scheduler->AddTask ("DER", [this, last]() {
+        auto now = std::chrono::steady_clock::now ();
+        std::chrono::duration <float, std::milli> delta_time = now - *last;
+        *last = now;
+        this->Loop (delta_time.count ());  // virtual, children may override
+    }, period_ms);
+}  // end Schedule
+
 // Display
 // - print device properties to terminal
 void DistributedEnergyResource::Display () {
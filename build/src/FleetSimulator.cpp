@@ -0,0 +1,357 @@
+// INCLUDES
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <memory>
+#include "include/FleetSimulator.h"
+#include "include/Scheduler.h"
+
+// Config Value
+// - optional config value with a default
+static float ConfigValue (std::map <std::string, std::string>& init,
+                          const std::string& key,
+                          float value) {
+    if (init.count (key)) {
+        return stof (init[key]);
+    }
+    return value;
+}
+
+// Ramp
+// - move the power toward the setpoint by at most the ramp watts
+static inline float Ramp (float power, float watts, float ramp_watts) {
+    float up = power + ramp_watts;
+    float down = power - ramp_watts;
+    up = up < watts ? up : watts;
+    down = down > watts ? down : watts;
+    return power < watts ? up : down;
+}
+
+// Constructor
+// - every device gets the rated properties of the config scaled by a uniform
+// - variation so the fleet is not identical, and a random state of charge
+// - using the same normal distribution as the DER simulator.
+FleetSimulator::FleetSimulator (std::map <std::string, std::string> init)
+    : size_(stoul(init["devices"])),
+      step_ms_(ConfigValue (init, "step", 1000)),
+      total_import_power_(0),
+      total_export_power_(0),
+      last_import_watts_(0),
+      last_export_watts_(0),
+      step_us_(0) {
+    SetLogPath (init["log_path"]);
+    SetLogIncrement (ConfigValue (init, "log_inc", 60));
+    SetLogBinary (init["log_format"] == "binary");
+
+    std::random_device seed {};
+    std::mt19937 gen {seed ()};
+    float variation = ConfigValue (init, "variation", 0);
+    std::uniform_real_distribution <float> spread (1 - variation, 1 + variation);
+    std::normal_distribution <float> distribution (
+        stof (init["normal_mean"]), stof (init["standard_deviation"])
+    );
+
+    Devices& d = devices_;
+    for (unsigned int i = 0; i < size_; i++) {
+        float scale = spread (gen);
+        d.rated_import_power.push_back (
+            stof (init["rated_import_power"]) * scale
+        );
+        d.rated_export_power.push_back (
+            stof (init["rated_export_power"]) * scale
+        );
+        d.rated_import_energy.push_back (
+            stof (init["rated_import_energy"]) * scale
+        );
+        d.rated_export_energy.push_back (
+            stof (init["rated_export_energy"]) * scale
+        );
+        d.import_ramp.push_back (stof (init["rated_import_ramp"]) * scale);
+        d.export_ramp.push_back (stof (init["rated_export_ramp"]) * scale);
+        d.idle_losses.push_back (stof (init["idle_losses"]) * scale);
+
+        float percent = 2;
+        while (percent > 1 || percent < 0) {
+            percent = distribution (gen);
+        }
+        d.import_energy.push_back (d.rated_import_energy[i] * percent);
+        d.export_energy.push_back (d.rated_export_energy[i] * (1 - percent));
+
+        total_import_power_ += d.rated_import_power[i];
+        total_export_power_ += d.rated_export_power[i];
+    }
+    d.import_watts.assign (size_, 0);
+    d.export_watts.assign (size_, 0);
+    d.import_power.assign (size_, 0);
+    d.export_power.assign (size_, 0);
+
+    // the aggregate DER properties are the sum of the fleet
+    double import_energy = 0;
+    double export_energy = 0;
+    for (unsigned int i = 0; i < size_; i++) {
+        import_energy += d.rated_import_energy[i];
+        export_energy += d.rated_export_energy[i];
+    }
+    SetRatedImportPower (total_import_power_);
+    SetRatedExportPower (total_export_power_);
+    SetRatedImportEnergy (import_energy);
+    SetRatedExportEnergy (export_energy);
+    FleetSimulator::UpdateAggregate ();
+}  // end constructor
+
+FleetSimulator::~FleetSimulator () {
+    // do nothing
+}  // end destructor
+
+// Loop
+// - paced step, the delta time is the milliseconds since the last step
+void FleetSimulator::Loop (float delta_time) {
+    FleetSimulator::DispatchAggregate ();
+
+    auto start = std::chrono::steady_clock::now ();
+    FleetSimulator::Step (delta_time / 1000);
+    std::chrono::duration <float, std::micro> elapsed
+        = std::chrono::steady_clock::now () - start;
+    step_us_ = elapsed.count ();
+
+    FleetSimulator::UpdateAggregate ();
+    Log ();
+}  // end Loop
+
+// Schedule
+// - step the fleet on the configured step period instead of the loop period
+void FleetSimulator::Schedule (Scheduler* scheduler, unsigned int period_ms) {
+    (void)period_ms;
+    auto last = std::make_shared <std::chrono::steady_clock::time_point> (
+        std::chrono::steady_clock::now ()
+    );
+    scheduler->AddTask ("Fleet", [this, last]() {
+        auto now = std::chrono::steady_clock::now ();
+        std::chrono::duration <float, std::milli> delta_time = now - *last;
+        *last = now;
+        FleetSimulator::Loop (delta_time.count ());
+    }, step_ms_);
+}  // end Schedule
+
+// Display
+// - print the aggregate properties and the step time
+void FleetSimulator::Display () {
+    std::cout << "[Fleet]\n"
+        << "Devices:\t" << size_ << '\n'
+        << "Step Time:\t" << step_us_ << "\tmicroseconds\n";
+    DistributedEnergyResource::Display ();
+}  // end Display
+
+// Set Import Watts
+// - device import setpoint, the same as the DER setter
+void FleetSimulator::SetImportWatts (unsigned int device, unsigned int power) {
+    if (device >= size_) {
+        std::cout << "[ERROR]\t" << "SetImportWatts: invalid device " << device
+            << '\n';
+        return;
+    }
+    std::lock_guard <std::mutex> lock (command_mutex_);
+    commands_.push_back ({device, true, power});
+}  // end Set Import Watts
+
+// Set Export Watts
+// - device export setpoint, the same as the DER setter
+void FleetSimulator::SetExportWatts (unsigned int device, unsigned int power) {
+    if (device >= size_) {
+        std::cout << "[ERROR]\t" << "SetExportWatts: invalid device " << device
+            << '\n';
+        return;
+    }
+    std::lock_guard <std::mutex> lock (command_mutex_);
+    commands_.push_back ({device, false, power});
+}  // end Set Export Watts
+
+// Step Devices
+// - advance every device by the given seconds. This mirrors ImportPower,
+// - ExportPower and IdleLoss of the DER, but the three modes are computed for
+// - every device and selected so the loop has no branches. The arrays are
+// - passed as restrict parameters so gcc knows they do not alias.
+static void StepDevices (float seconds,
+                         unsigned int size,
+                         const float* __restrict__ rated_import_power,
+                         const float* __restrict__ rated_export_power,
+                         const float* __restrict__ rated_import_energy,
+                         const float* __restrict__ rated_export_energy,
+                         const float* __restrict__ import_ramp,
+                         const float* __restrict__ export_ramp,
+                         const float* __restrict__ idle_losses,
+                         float* __restrict__ import_watts,
+                         float* __restrict__ export_watts,
+                         float* __restrict__ import_power,
+                         float* __restrict__ export_power,
+                         float* __restrict__ import_energy,
+                         float* __restrict__ export_energy) {
+    const float hours = seconds / (60*60);
+    for (unsigned int i = 0; i < size; i++) {
+        // regulate power
+        float import_ramp_watts = import_ramp[i] * seconds;
+        float export_ramp_watts = export_ramp[i] * seconds;
+        float ip = Ramp (import_power[i], import_watts[i], import_ramp_watts);
+        float ep = Ramp (export_power[i], export_watts[i], export_ramp_watts);
+
+        // energy is the area under the power, the ramp triangle is included
+        // until the device reaches rated power. Every mode is computed and
+        // then selected, the setters keep import and export exclusive.
+        float import_triangle = ip < rated_import_power[i]
+            ? import_ramp_watts : 0.0f;
+        float export_triangle = ep < rated_export_power[i]
+            ? export_ramp_watts : 0.0f;
+        float import_wh = (ip + import_triangle * 0.5f) * hours;
+        float export_wh = (ep + export_triangle * 0.5f) * hours;
+        float idle_wh = idle_losses[i] * hours;
+        float stored = -idle_wh;
+        stored = import_watts[i] > 0 ? import_wh : stored;
+        stored = export_watts[i] > 0 ? -export_wh : stored;
+
+        // regulate energy
+        float ie = import_energy[i] - stored;
+        float ee = export_energy[i] + stored;
+        ie = ie < rated_import_energy[i] ? ie : rated_import_energy[i];
+        ee = ee < rated_export_energy[i] ? ee : rated_export_energy[i];
+        import_energy[i] = ie > 0 ? ie : 0.0f;
+        export_energy[i] = ee > 0 ? ee : 0.0f;
+        import_power[i] = ip;
+        export_power[i] = ep;
+    }
+
+    // stop the control when the device is full/empty. This is a separate loop
+    // because gcc turns the conditional setpoint store into a branch, which
+    // stops the loop above from being vectorized.
+    for (unsigned int i = 0; i < size; i++) {
+        import_watts[i] = import_energy[i] > 0 ? import_watts[i] : 0.0f;
+        export_watts[i] = export_energy[i] > 0 ? export_watts[i] : 0.0f;
+    }
+}  // end Step Devices
+
+// Step
+// - apply the queued device setpoints then advance the fleet
+void FleetSimulator::Step (float seconds) {
+    FleetSimulator::ApplyCommands ();
+
+    Devices& d = devices_;
+    StepDevices (seconds,
+                 size_,
+                 d.rated_import_power.data (),
+                 d.rated_export_power.data (),
+                 d.rated_import_energy.data (),
+                 d.rated_export_energy.data (),
+                 d.import_ramp.data (),
+                 d.export_ramp.data (),
+                 d.idle_losses.data (),
+                 d.import_watts.data (),
+                 d.export_watts.data (),
+                 d.import_power.data (),
+                 d.export_power.data (),
+                 d.import_energy.data (),
+                 d.export_energy.data ());
+}  // end Step
+
+// Simulate
+// - step as fast as possible over the simulated seconds. The dispatch is
+// - called before every step so a strategy can update the setpoints.
+void FleetSimulator::Simulate (double seconds, float step, Dispatch dispatch) {
+    for (double time = 0; time < seconds; time += step) {
+        if (dispatch) {
+            dispatch (this, time);
+        }
+        FleetSimulator::DispatchAggregate ();
+        FleetSimulator::Step (step);
+    }
+    FleetSimulator::UpdateAggregate ();
+}  // end Simulate
+
+// Get Size
+unsigned int FleetSimulator::GetSize () const {
+    return size_;
+}  // end Get Size
+
+// Get Devices
+// - the device arrays must only be read by the thread that steps the fleet
+const FleetSimulator::Devices& FleetSimulator::GetDevices () const {
+    return devices_;
+}  // end Get Devices
+
+// Apply Commands
+// - device setpoints are queued by the setters so they can be called from any
+// - thread, and applied before the next step with the DER setter rules.
+void FleetSimulator::ApplyCommands () {
+    {
+        std::lock_guard <std::mutex> lock (command_mutex_);
+        if (commands_.empty ()) {
+            return;
+        }
+        pending_.swap (commands_);
+    }
+
+    Devices& d = devices_;
+    for (const auto& command : pending_) {
+        unsigned int i = command.device;
+        float power = command.power;
+        if (command.import) {
+            d.export_watts[i] = 0;
+            d.export_power[i] = 0;
+            d.import_watts[i] = power < d.rated_import_power[i]
+                ? power : d.rated_import_power[i];
+        } else {
+            d.import_watts[i] = 0;
+            d.import_power[i] = 0;
+            d.export_watts[i] = power < d.rated_export_power[i]
+                ? power : d.rated_export_power[i];
+        }
+    }
+    pending_.clear ();
+}  // end Apply Commands
+
+// Dispatch Aggregate
+// - when the aggregate setpoint changes split it between the devices by their
+// - share of the rated power.
+void FleetSimulator::DispatchAggregate () {
+    unsigned int import_watts = GetImportWatts ();
+    unsigned int export_watts = GetExportWatts ();
+    if (import_watts == last_import_watts_
+        && export_watts == last_export_watts_) {
+        return;
+    }
+    last_import_watts_ = import_watts;
+    last_export_watts_ = export_watts;
+
+    float import_share = total_import_power_ > 0
+        ? import_watts / total_import_power_ : 0;
+    float export_share = total_export_power_ > 0
+        ? export_watts / total_export_power_ : 0;
+    float importing = import_watts > 0 ? 1.0f : 0.0f;
+    float exporting = export_watts > 0 ? 1.0f : 0.0f;
+
+    Devices& d = devices_;
+    for (unsigned int i = 0; i < size_; i++) {
+        d.import_watts[i] = d.rated_import_power[i] * import_share;
+        d.export_watts[i] = d.rated_export_power[i] * export_share;
+        d.import_power[i] *= 1.0f - exporting;
+        d.export_power[i] *= 1.0f - importing;
+    }
+}  // end Dispatch Aggregate
+
+// Update Aggregate
+// - set the DER properties to the sum of the fleet
+void FleetSimulator::UpdateAggregate () {
+    double import_power = 0;
+    double export_power = 0;
+    double import_energy = 0;
+    double export_energy = 0;
+    const Devices& d = devices_;
+    for (unsigned int i = 0; i < size_; i++) {
+        import_power += d.import_power[i];
+        export_power += d.export_power[i];
+        import_energy += d.import_energy[i];
+        export_energy += d.export_energy[i];
+    }
+    SetImportPower (import_power);
+    SetExportPower (export_power);
+    SetImportEnergy (import_energy);
+    SetExportEnergy (export_energy);
+}  // end Update Aggregate
@@ -1,23 +1,58 @@
 // INCLUDES
 #include <iostream>
+#include <algorithm>
 #include <ctime>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "include/Operator.h"
-#include "include/tsu.h"
 
-// the constructor reads the given schedule and stores it in memory
-Operator::Operator (const std::string& filename, 
-                    DistributedEnergyResource* der_ptr) 
-    : index_(0), der_ptr_(der_ptr) {
-    tsu::string_matrix matrix = tsu::FileToMatrix(filename, ',', 3);
+// Modified
+// - file modification time in nanoseconds so quick rewrites are not missed
+static int64_t Modified (const struct stat& status) {
+    return int64_t (status.st_mtim.tv_sec)*1000000000 + status.st_mtim.tv_nsec;
+}  // end Modified
 
-    // reserve memory for each row within the matrix
-    schedule_.reserve(matrix.size());
+// Parse Number
+// - read an unsigned integer and advance the cursor, false if no digits
+static bool ParseNumber (const char*& cursor, const char* end, uint32_t& value) {
+    const char* start = cursor;
+    uint64_t number = 0;
+    while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+        number = number*10 + (*cursor - '0');
+        cursor++;
+    }
+    value = static_cast <uint32_t> (number);
+    return cursor != start && number <= UINT32_MAX;
+}  // end Parse Number
+
+// Parse Control
+// - map the control word to the enum, unknown words are idle like before
+static Operator::Control ParseControl (const char* word, size_t length) {
+    if (length == 6 && std::memcmp (word, "import", 6) == 0) {
+        return Operator::Control::IMPORT;
+    } else if (length == 6 && std::memcmp (word, "export", 6) == 0) {
+        return Operator::Control::EXPORT;
+    }
+    return Operator::Control::IDLE;
+}  // end Parse Control
 
-    // loop through each row of the matrix and set each column to it's
-    // header data type
-    for (const auto &col : matrix) {
-        schedule_.emplace_back (stoi(col[0]), col[1], stoul(col[2]));
+// the constructor compiles the given schedule, the loop will retry if the
+// file can not be read yet
+Operator::Operator (const std::string& filename,
+                    DistributedEnergyResource* der_ptr,
+                    bool daily)
+    : filename_(filename), der_ptr_(der_ptr), daily_(daily), index_(kNone) {
+    std::shared_ptr <Schedule> schedule = Operator::Compile ();
+    if (!schedule) {
+        std::cout << "[ERROR]\t" << "Operator: failed to load " << filename_
+            << '\n';
+        return;
     }
+    std::atomic_store (&schedule_,
+                       std::shared_ptr <const Schedule> (schedule));
 }  // end constructor
 
 Operator::~Operator () {
@@ -25,31 +60,264 @@ Operator::~Operator () {
 }  // end destructor
 
 // Loop
-// - gets the utc time and takes the modulus so the actual day of the scheduel
-// - is neglected.
+// - reload the schedule if the file changed and dispatch the active entry
+// - when it changes. The day is neglected if the schedule is daily.
 void Operator::Loop () {
-    // get the current time utc and take modulo to neglect days
-    unsigned int seconds_per_day = 60*60*24;
-    unsigned int utc = time(NULL) % seconds_per_day;
+    Operator::Reload ();
+
+    std::shared_ptr <const Schedule> schedule = std::atomic_load (&schedule_);
+    if (schedule != active_) {
+        // a new schedule always dispatches its active entry
+        active_ = schedule;
+        index_ = kNone;
+    }
+    if (!active_ || active_->entries.empty ()) {
+        return;
+    }
+
+    uint32_t utc = static_cast <uint32_t> (time (NULL));
+    if (active_->daily) {
+        utc %= kSecondsPerDay;
+    }
+
+    size_t index = Operator::Find (*active_, utc);
+    if (index != index_) {
+        index_ = index;
+        if (index != kNone) {
+            Operator::Dispatch (active_->entries[index]);
+        }
+    }
+}  // end Loop
 
-    // loop through each row of schedule looking for current time
-    for (unsigned int i = index_; i < schedule_.size(); i++) {
-        ScheduleHeader& row = schedule_[i];
+// Reload
+// - compile the schedule again if the file time or size changed and swap it
+// - in. The current schedule is kept if the file can not be compiled.
+bool Operator::Reload () {
+    struct stat status;
+    if (stat (filename_.c_str (), &status) != 0) {
+        return false;
+    }
+
+    std::shared_ptr <const Schedule> current = std::atomic_load (&schedule_);
+    if (current
+        && current->modified == Modified (status)
+        && current->size == status.st_size) {
+        return false;
+    }
 
-        if (row.time % seconds_per_day == utc && index_ != i) {
+    std::shared_ptr <Schedule> schedule = Operator::Compile ();
+    if (!schedule) {
+        // remember the bad file so it is only reported once
+        std::shared_ptr <Schedule> kept (new Schedule ());
+        kept->daily = daily_;
+        if (current) {
+            kept->entries = current->entries;
+            kept->daily = current->daily;
+        }
+        kept->modified = Modified (status);
+        kept->size = status.st_size;
+        std::cout << "[ERROR]\t" << "Operator: keeping previous schedule\n";
+        schedule = kept;
+    }
+    std::atomic_store (&schedule_,
+                       std::shared_ptr <const Schedule> (schedule));
+    return true;
+}  // end Reload
+
+// Get Schedule
+// - the latest compiled schedule, safe to call from any thread
+std::shared_ptr <const Operator::Schedule> Operator::GetSchedule () const {
+    return std::atomic_load (&schedule_);
+}  // end Get Schedule
+
+// Compile
+// - read the file and parse each "utc,control,setting" row straight into an
+// - entry without building intermediate strings. A first row that does not
+// - start with a number is taken as a header, any other bad row fails the
+// - compile. Entries are sorted by time and the last row of equal times wins.
+// - The file is read into a buffer instead of mapped so a writer truncating
+// - it in place can only cause a short read, which fails the compile.
+std::shared_ptr <Operator::Schedule> Operator::Compile () const {
+    int fd = open (filename_.c_str (), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat status;
+    if (fstat (fd, &status) != 0) {
+        close (fd);
+        return nullptr;
+    }
+
+    std::shared_ptr <Schedule> schedule (new Schedule ());
+    schedule->modified = Modified (status);
+    schedule->size = status.st_size;
+    schedule->daily = daily_;
+    if (status.st_size == 0) {
+        close (fd);
+        return schedule;
+    }
+
+    std::vector <char> buffer (status.st_size);
+    size_t length = 0;
+    while (length < buffer.size ()) {
+        ssize_t bytes = read (fd, &buffer[length], buffer.size () - length);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        } else if (bytes <= 0) {
+            break;
+        }
+        length += bytes;
+    }
+    close (fd);
+    if (length != buffer.size ()) {
+        std::cout << "[ERROR]\t" << "Operator: " << filename_
+            << " changed while it was read\n";
+        return nullptr;
+    }
 
-            // if the time is found check control type
-            if (row.control == "import") {
-                der_ptr_->SetImportWatts(row.setting);
-            } else if (row.control == "export") {
-                der_ptr_->SetExportWatts(row.setting);
+    const char* cursor = &buffer[0];
+    const char* end = cursor + length;
+    std::vector <Entry>& entries = schedule->entries;
+    // rows are about 20 bytes so this avoids most of the regrowth
+    entries.reserve (status.st_size / 20);
+
+    unsigned int line = 0;
+    bool valid = true;
+    uint32_t first = UINT32_MAX;
+    uint32_t last = 0;
+    while (cursor < end && valid) {
+        const char* eol = static_cast <const char*> (
+            std::memchr (cursor, '\n', end - cursor)
+        );
+        if (!eol) {
+            eol = end;
+        }
+        const char* row_end = eol;
+        if (row_end > cursor && *(row_end - 1) == '\r') {
+            row_end--;
+        }
+        line++;
+
+        if (row_end != cursor) {
+            Entry entry;
+            const char* field = cursor;
+            const char* comma = static_cast <const char*> (
+                std::memchr (field, ',', row_end - field)
+            );
+            valid = ParseNumber (field, row_end, entry.time)
+                && field == comma;
+            if (valid) {
+                const char* word = comma + 1;
+                comma = static_cast <const char*> (
+                    std::memchr (word, ',', row_end - word)
+                );
+                valid = comma != NULL;
+                if (valid) {
+                    entry.control = ParseControl (word, comma - word);
+                    field = comma + 1;
+                    valid = ParseNumber (field, row_end, entry.setting)
+                        && field == row_end;
+                }
+            }
+
+            if (valid) {
+                first = std::min (first, entry.time);
+                last = std::max (last, entry.time);
+                entries.push_back (entry);
+            } else if (line == 1 && (*cursor < '0' || *cursor > '9')) {
+                valid = true;   // header
             } else {
-                der_ptr_->SetImportWatts(0);
+                std::cout << "[ERROR]\t" << "Operator: " << filename_
+                    << " line " << line << " is not utc,control,setting\n";
             }
+        }
+        cursor = eol + 1;
+    }
+    if (!valid) {
+        return nullptr;
+    }
+
+    // folding a schedule that spans a day or more would overwrite entries of
+    // different days that share a time of day, so it is kept absolute
+    if (schedule->daily && !entries.empty () && last - first >= kSecondsPerDay) {
+        std::cout << "[WARNING]\t" << "Operator: " << filename_
+            << " spans more than a day and is not repeated daily\n";
+        schedule->daily = false;
+    }
+    if (schedule->daily) {
+        for (auto& entry : entries) {
+            entry.time %= kSecondsPerDay;
+        }
+    }
 
-            // log index so multiple controls are not sent and to reduce
-            // search time.
-            index_ = i;
+    auto earlier = [](const Entry& a, const Entry& b) {
+        return a.time < b.time;
+    };
+    if (!std::is_sorted (entries.begin (), entries.end (), earlier)) {
+        std::stable_sort (entries.begin (), entries.end (), earlier);
+    }
+
+    // keep the last entry of each time
+    size_t count = 0;
+    for (size_t i = 0; i < entries.size (); i++) {
+        if (count > 0 && entries[count - 1].time == entries[i].time) {
+            count--;
+        }
+        entries[count++] = entries[i];
+    }
+    entries.resize (count);
+    entries.shrink_to_fit ();
+    return schedule;
+}  // end Compile
+
+// Find
+// - index of the last entry at or before the time. The cursor is checked
+// - first since the time normally stays within or moves to the next entry,
+// - anything else is a binary search. Before the first entry a daily
+// - schedule wraps to the last entry of the previous day.
+size_t Operator::Find (const Schedule& schedule, uint32_t time) {
+    const std::vector <Entry>& entries = schedule.entries;
+    size_t size = entries.size ();
+    auto active = [&entries, size, time](size_t i) {
+        return i < size
+            && entries[i].time <= time
+            && (i + 1 == size || entries[i + 1].time > time);
+    };
+
+    if (index_ != kNone) {
+        if (active (index_)) {
+            return index_;
+        } else if (active (index_ + 1)) {
+            return index_ + 1;
+        }
+    }
+
+    auto it = std::upper_bound (entries.begin (), entries.end (), time,
+                                [](uint32_t value, const Entry& entry) {
+        return value < entry.time;
+    });
+    if (it == entries.begin ()) {
+        return schedule.daily ? size - 1 : kNone;
+    }
+    return (it - entries.begin ()) - 1;
+}  // end Find
+
+// Dispatch
+// - send the entry control to the der
+void Operator::Dispatch (const Entry& entry) {
+    switch (entry.control) {
+        case Control::IMPORT: {
+            der_ptr_->SetImportWatts (entry.setting);
+            break;
+        }
+        case Control::EXPORT: {
+            der_ptr_->SetExportWatts (entry.setting);
+            break;
+        }
+        case Control::IDLE: {
+            der_ptr_->SetImportWatts (0);
+            break;
         }
     }
-}  // end Loop
\ No newline at end of file
+}  // end Dispatch
\ No newline at end of file
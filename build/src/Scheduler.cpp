@@ -0,0 +1,242 @@
+// INCLUDES
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include "include/Scheduler.h"
+
+// Microseconds
+// - duration in microseconds used by the task counters
+static int64_t Microseconds (std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast <std::chrono::microseconds> (
+        duration
+    ).count ();
+}
+
+// Constructor
+Scheduler::Scheduler (unsigned int workers)
+    : workers_(workers == 0 ? 1 : workers),
+      running_(false) {
+}  // end constructor
+
+Scheduler::~Scheduler () {
+    Scheduler::Stop ();
+}  // end destructor
+
+// Add Task
+// - register a periodic task. The phase is the offset from the wall clock
+// - period boundary, so a 5000 ms task with a 0 ms phase runs on every utc
+// - second that is a multiple of 5. Returns the task id used by the stats.
+unsigned int Scheduler::AddTask (const std::string& name,
+                                 std::function <void ()> task,
+                                 unsigned int period_ms,
+                                 unsigned int phase_ms,
+                                 Overrun policy) {
+    if (running_) {
+        std::cout << "[ERROR]\t" << "AddTask: scheduler is running " << name
+            << '\n';
+        return tasks_.size ();
+    }
+    if (period_ms == 0) {
+        std::cout << "[ERROR]\t" << "AddTask: invalid period for " << name
+            << '\n';
+        period_ms = 1;
+    }
+
+    Task new_task;
+    new_task.function = task;
+    new_task.period = std::chrono::milliseconds (period_ms);
+    new_task.phase = std::chrono::milliseconds (phase_ms);
+    new_task.policy = policy;
+    new_task.stats = Stats ();
+    new_task.stats.name = name;
+    new_task.stats.period_ms = period_ms;
+
+    std::lock_guard <std::mutex> lock (mutex_);
+    tasks_.push_back (new_task);
+    return tasks_.size () - 1;
+}  // end Add Task
+
+// Start
+// - align the first deadline of each task to the wall clock and spawn the
+// - worker threads. The steady clock is used from then on so the cadence is
+// - not affected by changes to the system time.
+void Scheduler::Start () {
+    if (running_) {
+        return;
+    }
+
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        auto steady_now = std::chrono::steady_clock::now ();
+        int64_t system_now = std::chrono::duration_cast
+            <std::chrono::microseconds> (
+                std::chrono::system_clock::now ().time_since_epoch ()
+            ).count ();
+
+        heap_.clear ();
+        for (unsigned int id = 0; id < tasks_.size (); id++) {
+            Task& task = tasks_[id];
+            int64_t period = task.period.count ();
+            int64_t phase = task.phase.count ();
+            int64_t offset = ((phase - system_now) % period + period) % period;
+            task.deadline = steady_now + std::chrono::microseconds (offset);
+            Scheduler::Push (id);
+        }
+        running_ = true;
+    }
+
+    for (unsigned int i = 0; i < workers_; i++) {
+        threads_.emplace_back (&Scheduler::Run, this);
+    }
+}  // end Start
+
+// Stop
+// - signal the workers and wait for the running tasks to finish
+void Scheduler::Stop () {
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        running_ = false;
+    }
+    wait_.notify_all ();
+    for (auto& thread : threads_) {
+        if (thread.joinable ()) {
+            thread.join ();
+        }
+    }
+    threads_.clear ();
+}  // end Stop
+
+// Run
+// - each worker waits for the earliest deadline, takes the task off the heap
+// - and runs it outside of the lock.
+void Scheduler::Run () {
+    std::unique_lock <std::mutex> lock (mutex_);
+    while (running_) {
+        if (heap_.empty ()) {
+            wait_.wait (lock);
+            continue;
+        }
+
+        unsigned int id = heap_.front ();
+        time_point deadline = tasks_[id].deadline;
+        if (std::chrono::steady_clock::now () < deadline) {
+            wait_.wait_until (lock, deadline);
+            continue;
+        }
+
+        std::pop_heap (heap_.begin (), heap_.end (), [this](unsigned int a,
+                                                            unsigned int b) {
+            return tasks_[a].deadline > tasks_[b].deadline;
+        });
+        heap_.pop_back ();
+
+        // let another worker take the next deadline
+        wait_.notify_one ();
+
+        // the task vector is not resized after start so the function can be
+        // called without holding the lock
+        std::function <void ()>& function = tasks_[id].function;
+        lock.unlock ();
+        time_point start = std::chrono::steady_clock::now ();
+        function ();
+        time_point end = std::chrono::steady_clock::now ();
+        lock.lock ();
+
+        Scheduler::Reschedule (id, start, end);
+    }
+}  // end Run
+
+// Reschedule
+// - update the task counters and compute the next deadline from the last one
+void Scheduler::Reschedule (unsigned int id, time_point start, time_point end) {
+    Task& task = tasks_[id];
+    Stats& stats = task.stats;
+    int64_t jitter = Microseconds (start - task.deadline);
+    stats.runs++;
+    stats.jitter_last = jitter;
+    stats.jitter_max = std::max (stats.jitter_max, jitter);
+    stats.jitter_total += jitter;
+    stats.runtime_max = std::max (stats.runtime_max, Microseconds (end - start));
+
+    time_point next = task.deadline + task.period;
+    if (end > next) {
+        stats.overruns++;
+        switch (task.policy) {
+            case Overrun::SKIP: {
+                int64_t missed = (end - next) / task.period + 1;
+                next += missed * task.period;
+                stats.skipped += missed;
+                break;
+            }
+            case Overrun::CATCH_UP: {
+                break;
+            }
+            case Overrun::DELAY: {
+                next = end + task.period;
+                break;
+            }
+        }
+    }
+    task.deadline = next;
+    Scheduler::Push (id);
+    wait_.notify_one ();
+}  // end Reschedule
+
+// Push
+// - add a task to the deadline heap, the lock must be held
+void Scheduler::Push (unsigned int id) {
+    heap_.push_back (id);
+    std::push_heap (heap_.begin (), heap_.end (), [this](unsigned int a,
+                                                         unsigned int b) {
+        return tasks_[a].deadline > tasks_[b].deadline;
+    });
+}  // end Push
+
+// Get Stats
+// - copy of the counters for each task
+std::vector <Scheduler::Stats> Scheduler::GetStats () {
+    std::lock_guard <std::mutex> lock (mutex_);
+    std::vector <Stats> stats;
+    stats.reserve (tasks_.size ());
+    for (const auto& task : tasks_) {
+        stats.push_back (task.stats);
+    }
+    return stats;
+}  // end Get Stats
+
+// Display
+// - print the task counters to terminal, jitter and runtime are milliseconds
+void Scheduler::Display () {
+    std::cout << "[Scheduler]\n"
+        << std::left << std::setw (16) << "\tTask"
+        << std::right
+        << std::setw (8) << "Period"
+        << std::setw (10) << "Runs"
+        << std::setw (10) << "Overruns"
+        << std::setw (10) << "Skipped"
+        << std::setw (10) << "Jitter"
+        << std::setw (10) << "Mean"
+        << std::setw (10) << "Max"
+        << std::setw (10) << "Runtime" << '\n';
+
+    std::ios::fmtflags flags = std::cout.flags ();
+    std::streamsize precision = std::cout.precision ();
+    std::cout << std::fixed << std::setprecision (2);
+    for (const auto& stats : Scheduler::GetStats ()) {
+        double mean = stats.runs == 0
+            ? 0 : double (stats.jitter_total) / stats.runs;
+        std::cout << '\t' << std::left << std::setw (15) << stats.name
+            << std::right
+            << std::setw (8) << stats.period_ms
+            << std::setw (10) << stats.runs
+            << std::setw (10) << stats.overruns
+            << std::setw (10) << stats.skipped
+            << std::setw (10) << stats.jitter_last / 1000.0
+            << std::setw (10) << mean / 1000.0
+            << std::setw (10) << stats.jitter_max / 1000.0
+            << std::setw (10) << stats.runtime_max / 1000.0 << '\n';
+    }
+    std::cout.flags (flags);
+    std::cout.precision (precision);
+    std::cout << std::endl;
+}  // end Display
@@ -1,20 +1,37 @@
 
 // INCLUDES
 #include <iostream>
+#include <sstream>
+#include <chrono>
 #include <ctime>
 #include <cmath>
 #include "include/SmartGridDevice.h"
 
+// Milliseconds
+// - steady clock time used for the coalesce window
+static uint64_t Milliseconds () {
+    return std::chrono::duration_cast <std::chrono::milliseconds> (
+        std::chrono::steady_clock::now ().time_since_epoch ()
+    ).count ();
+}
+
 // Constructor
 // - initialize bus object interface and smart grid device properties
 SmartGridDevice::SmartGridDevice (DistributedEnergyResource* der_ptr,
                                   ajn::BusAttachment* bus_ptr,
                                   const char* name,
-                                  const char* path) : ajn::BusObject(path),
-                                                      der_ptr_(der_ptr),
-                                                      bus_ptr_(bus_ptr),
-                                                      signal_(NULL),
-                                                      interface_(name) {
+                                  const char* path,
+                                  std::map <std::string, std::string>& configs)
+    : ajn::BusObject(path),
+      der_ptr_(der_ptr),
+      bus_ptr_(bus_ptr),
+      signal_(NULL),
+      interface_(name),
+      pending_(0),
+      pending_ms_(0),
+      coalesce_ms_(1000),
+      heartbeat_(60*60),
+      last_heartbeat_utc_(time (0)) {
     const ajn::InterfaceDescription* interface = bus_ptr_->GetInterface(interface_);
     assert(interface != NULL);
     AddInterface(*interface, ANNOUNCED);
@@ -37,8 +54,55 @@ SmartGridDevice::SmartGridDevice (DistributedEnergyResource* der_ptr,
         throw status;
     }
 
-    last_import_energy_ = der_ptr_->GetImportEnergy ();
-    last_export_energy_ = der_ptr_->GetExportEnergy ();
+    // the rated properties only change with the device so any change is sent,
+    // power and energy use the 10% that triggered the old energy deviation
+    typedef DistributedEnergyResource DER;
+    properties_ = {
+        {"rated_export_power", &DER::GetRatedExportPower, 0, 0, 0},
+        {"export_power", &DER::GetExportPower, 100, 0.1, 0},
+        {"rated_export_energy", &DER::GetRatedExportEnergy, 0, 0, 0},
+        {"export_energy", &DER::GetExportEnergy, 0, 0.1, 0},
+        {"export_ramp", &DER::GetExportRamp, 0, 0, 0},
+        {"rated_import_power", &DER::GetRatedImportPower, 0, 0, 0},
+        {"import_power", &DER::GetImportPower, 100, 0.1, 0},
+        {"rated_import_energy", &DER::GetRatedImportEnergy, 0, 0, 0},
+        {"import_energy", &DER::GetImportEnergy, 0, 0.1, 0},
+        {"import_ramp", &DER::GetImportRamp, 0, 0, 0},
+        {"idle_losses", &DER::GetIdleLosses, 0, 0, 0}
+    };
+
+    // deadband_<property>=absolute,relative
+    for (unsigned int i = 0; i < properties_.size (); i++) {
+        Property& property = properties_[i];
+        std::string key = std::string ("deadband_") + property.name;
+        if (configs.count (key) == 1) {
+            std::stringstream ss (configs[key]);
+            std::string absolute, relative;
+            std::getline (ss, absolute, ',');
+            std::getline (ss, relative, ',');
+            property.absolute = stof (absolute);
+            property.relative = relative.empty () ? 0 : stof (relative);
+        }
+        property.published = (der_ptr_->*property.getter) ();
+        index_[property.name] = i;
+    }
+
+    if (configs.count ("coalesce") == 1) {
+        coalesce_ms_ = stoul (configs["coalesce"]);
+    }
+    if (configs.count ("heartbeat") == 1) {
+        heartbeat_ = stoul (configs["heartbeat"]);
+    }
+}
+
+// Name Hash
+// - FNV-1a of the property name
+size_t SmartGridDevice::NameHash::operator () (const char* name) const {
+    size_t hash = 2166136261u;
+    for (; *name; name++) {
+        hash = (hash ^ static_cast <unsigned char> (*name)) * 16777619u;
+    }
+    return hash;
 }
 
 // Import Power Handler
@@ -65,100 +129,109 @@ void SmartGridDevice::ExportPowerHandler (
 
 // Get
 // - this method will be called by remote devices looking to get this devices
-// - properties
+// - properties. The value sent becomes the published value of the property.
 QStatus SmartGridDevice::Get (const char* interface,
                               const char* property,
                               ajn::MsgArg& value) {
-    QStatus status;
     if (strcmp(interface, interface_)) {
         return ER_FAIL;
     }
 
-    last_telemetry_utc_ = time (0);
-
-    if (!strcmp(property,"rated_import_power")) {
-        status = value.Set("u", der_ptr_->GetRatedImportPower ());
-        return status;
-    } else if (!strcmp(property,"rated_import_energy")) {
-        status = value.Set("u", der_ptr_->GetRatedImportEnergy ());
-        return status;
-    } else if (!strcmp(property,"import_power")) {
-        status = value.Set("u", der_ptr_->GetImportPower ());
-        return status;
-    } else if (!strcmp(property,"import_energy")) {
-        last_import_energy_ = der_ptr_->GetImportEnergy ();
-        status = value.Set("u", last_import_energy_);
-        return status;
-    } else if (!strcmp(property,"import_ramp")) {
-        status = value.Set("u", der_ptr_->GetImportRamp ());
-        return status;
-    } else if (!strcmp(property,"rated_export_power")) {
-        status = value.Set("u", der_ptr_->GetRatedExportPower ());
-        return status;
-    } else if (!strcmp(property,"rated_export_energy")) {
-        status = value.Set("u", der_ptr_->GetRatedExportEnergy ());
-        return status;
-    } else if (!strcmp(property,"export_power")) {
-        status = value.Set("u", der_ptr_->GetExportPower ());
-        return status;
-    } else if (!strcmp(property,"export_energy")) {
-        last_export_energy_ = der_ptr_->GetExportEnergy ();
-        status = value.Set("u", last_export_energy_);
-        return status;
-    } else if (!strcmp(property,"export_ramp")) {
-        status = value.Set("u", der_ptr_->GetExportRamp ());
-        return status;
-    } else if (!strcmp(property,"idle_losses")) {
-        status = value.Set("u", der_ptr_->GetIdleLosses ());
-        return status;
-    } else {
+    auto it = index_.find (property);
+    if (it == index_.end ()) {
         return ER_FAIL;
     }
+
+    Property& entry = properties_[it->second];
+    unsigned int current = (der_ptr_->*entry.getter) ();
+    {
+        std::lock_guard <std::mutex> lock (property_mutex_);
+        entry.published = current;
+        pending_ &= ~(1u << it->second);
+    }
+    return value.Set("u", current);
 } // end Get
 
+// Send Properties Update
+// - send the pending properties now without waiting for the coalesce window
 QStatus SmartGridDevice::SendPropertiesUpdate () {
-const char* props[] = { "rated_export_power",
-                        "export_power",
-                        "rated_export_energy",
-                        "export_energy",
-                        "export_ramp",
-                        "rated_import_power",
-                        "import_power",
-                        "rated_import_energy",
-                        "import_energy",
-                        "import_ramp",
-                        "idle_losses"};
-    QStatus status;
-    status = EmitPropChanged (interface_, props, 11, ajn::SESSION_ID_ALL_HOSTED);
-    return status;
+    uint32_t changed;
+    {
+        std::lock_guard <std::mutex> lock (property_mutex_);
+        changed = pending_;
+    }
+    return SmartGridDevice::Publish (changed);
 }  // end Send Properties Update
 
+// Publish
+// - emit one property changed signal for the properties in the changed mask
+QStatus SmartGridDevice::Publish (uint32_t changed) {
+    const char* names[32];
+    size_t count = 0;
+    {
+        std::lock_guard <std::mutex> lock (property_mutex_);
+        for (unsigned int i = 0; i < properties_.size (); i++) {
+            if (changed & (1u << i)) {
+                Property& property = properties_[i];
+                property.published = (der_ptr_->*property.getter) ();
+                names[count++] = property.name;
+            }
+        }
+        pending_ &= ~changed;
+    }
+    if (count == 0) {
+        return ER_OK;
+    }
+
+    // the lock is released since the bus reads the values through Get
+    QStatus status = EmitPropChanged (
+        interface_, names, count, ajn::SESSION_ID_ALL_HOSTED
+    );
+    if (ER_OK != status) {
+        std::cout << "[ERROR]\t" << "Publish: " << count << " properties , "
+            << QCC_StatusText (status) << '\n';
+    }
+    return status;
+}  // end Publish
+
 // Loop
-// - this loop will run in its own thread and check for high (dE/dt).
-// - it will also send the regularly scheduled telemetry
+// - this loop will run in its own thread and compare each property against
+// - the published value. A property that moved past its deadband is marked
+// - pending and the pending properties are sent together once the coalesce
+// - window from the first change has passed. Every heartbeat any change at
+// - all is sent so the server ends up with the exact values.
 void SmartGridDevice::Loop () {
+    uint64_t now_ms = Milliseconds ();
     unsigned int utc = time (0);
-    bool new_update = (last_telemetry_utc_ != utc);
-    bool five_minutes = (utc % (5*60) == 0);
-    bool one_hour = (utc % (60*60) == 0);
-
-    float import_energy = der_ptr_->GetImportEnergy ();
-    float export_energy = der_ptr_->GetExportEnergy ();
-    float delta_import = std::abs((import_energy / last_import_energy_) - 1);
-    float delta_export = std::abs((export_energy / last_export_energy_) - 1);
-    // import/export energy setting. Trigger at 10% (arbitrary)
-    bool energy_deviation = (delta_export > 0.1 || delta_import > 0.1);
-
-    // every hour send telemetry update
-    if (one_hour && new_update) {
-        QStatus status = SmartGridDevice::SendPropertiesUpdate ();
-        std::cout << "Sending telemetry update:\t" << status << std::endl;
-        last_telemetry_utc_ = utc;
-    // every 5 minutes check for deviation in import/export energy
-    } else if (five_minutes && new_update && energy_deviation) {
-        QStatus status = SmartGridDevice::SendPropertiesUpdate ();
-        std::cout << "Energy deviation... sending property update:\t" 
-            << status << std::endl;
-        last_telemetry_utc_ = utc;
+    bool heartbeat = heartbeat_ > 0
+        && utc / heartbeat_ != last_heartbeat_utc_ / heartbeat_;
+
+    uint32_t changed = 0;
+    {
+        std::lock_guard <std::mutex> lock (property_mutex_);
+        for (unsigned int i = 0; i < properties_.size (); i++) {
+            const Property& property = properties_[i];
+            unsigned int current = (der_ptr_->*property.getter) ();
+            float published = property.published;
+            float delta = std::abs (float (current) - published);
+            bool deadband = delta > property.absolute
+                && delta > property.relative * published;
+            if (deadband || (heartbeat && current != property.published)) {
+                changed |= 1u << i;
+            }
+        }
+        if (heartbeat) {
+            last_heartbeat_utc_ = utc;
+        }
+
+        if (pending_ == 0) {
+            pending_ms_ = now_ms;
+        }
+        pending_ |= changed;
+        if (pending_ == 0 || now_ms - pending_ms_ < coalesce_ms_) {
+            return;
+        }
+        changed = pending_;
     }
+    SmartGridDevice::Publish (changed);
 }
\ No newline at end of file
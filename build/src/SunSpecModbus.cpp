@@ -1,17 +1,68 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>  // rename
 #include <unistd.h>
 #include <sys/stat.h>
 #include "include/SunSpecModbus.h"
+#include "include/logger.h"
+
+// Make Directories
+// - create each directory of the path that does not exist yet
+static void MakeDirectories (const std::string& path) {
+    size_t slash = 0;
+    while (slash != std::string::npos) {
+        slash = path.find ('/', slash + 1);
+        std::string directory = path.substr (0, slash);
+        if (!directory.empty ()
+            && mkdir (directory.c_str (), 0755) != 0 && errno != EEXIST) {
+            std::cout << "[ERROR]\t" << "Make Directories: " << directory
+                << " , " << strerror (errno) << '\n';
+            return;
+        }
+    }
+}
 
 SunSpecModbus::SunSpecModbus (std::map <std::string, std::string>& configs)
-    : model_path_(configs["path"]), sunspec_key_(stoul(configs["key"])) {
+    : model_path_(configs["path"]),
+      sunspec_key_(stoul(configs["key"])),
+      max_read_(100),
+      max_write_(MODBUS_MAX_WRITE_REGISTERS),
+      query_delay_(1000) {
+    // some devices limit the registers per read/write request
+    if (configs.count ("max_read") == 1) {
+        max_read_ = std::max (1ul, std::min (stoul (configs["max_read"]),
+            static_cast <unsigned long> (MODBUS_MAX_READ_REGISTERS)));
+    }
+    if (configs.count ("max_write") == 1) {
+        max_write_ = std::max (1ul, std::min (stoul (configs["max_write"]),
+            static_cast <unsigned long> (MODBUS_MAX_WRITE_REGISTERS)));
+    }
+
+    // pause between models during discovery, the Radian needs the default
+    if (configs.count ("query_delay") == 1) {
+        query_delay_ = stoul (configs["query_delay"]);
+    }
+
+    // write errors go to the error log when a log path is configured
+    if (configs.count ("log_path") == 1) {
+        log_path_ = configs["log_path"];
+    }
+
+    // the model and device map cache is optional
+    if (configs.count ("cache") == 1) {
+        cache_path_ = configs["cache"];
+        MakeDirectories (cache_path_);
+    }
+
     // create modbus context pointer and connect to device at
     // given ip address and port number.
-    const char* ip = configs["ip"].c_str ();
-    unsigned int port = stoul(configs["port"]);
-    context_ptr_ = modbus_new_tcp(ip, port);
+    ip_ = configs["ip"];
+    port_ = stoul(configs["port"]);
+    context_ptr_ = modbus_new_tcp(ip_.c_str (), port_);
     if (modbus_connect(context_ptr_) == -1) {
         std::cout << "[ERROR] : " << modbus_strerror(errno) << '\n';
     }
@@ -53,6 +104,8 @@ SunSpecModbus::~SunSpecModbus () {
 // - sunspec model.
 // - If it is not a sunspec complient device then use the given did to simulate
 // - a sunspec model.
+// - When a cache path is configured the discovered model chain is stored and
+// - the next start only verifies it instead of walking the chain again.
 void SunSpecModbus::Query (unsigned int did) {
     uint16_t sunspec_id[2];
     // TODO (TS): sunspec states the holding register start can be
@@ -65,6 +118,11 @@ void SunSpecModbus::Query (unsigned int did) {
     // If match then increment offset by id length and read next two registers
     // to get DID and lenth of sunspec block
     if (device_key == sunspec_key_) {
+        if (SunSpecModbus::LoadDeviceMap ()) {
+            return;
+        }
+
+        std::vector <DeviceMapEntry> device_map;
         id_offset += 2;
         uint16_t did_and_length[2];
         SunSpecModbus::ReadRegisters(id_offset, 2, did_and_length);
@@ -75,24 +133,28 @@ void SunSpecModbus::Query (unsigned int did) {
         // while the next model file exists, create model and increment offset
         struct stat buffer;  // used to check if file exists
         while ((stat (filepath.c_str (), &buffer) == 0)) {
-            std::shared_ptr <SunSpecModel> model (
-                new SunSpecModel (did_and_length[0], id_offset, filepath)
-            );
+            std::shared_ptr <SunSpecModel> model (new SunSpecModel (
+                did_and_length[0], id_offset, filepath, cache_path_
+            ));
             models_.push_back (std::move (model));
+            device_map.push_back (
+                {did_and_length[0], id_offset, did_and_length[1]}
+            );
             std::map <std::string, std::string> block 
                 = SunSpecModbus::ReadBlock(did_and_length[0]);  // update sunssf
             id_offset += did_and_length[1] + 2; // block length not model length
             SunSpecModbus::ReadRegisters(id_offset, 2, did_and_length);
             SunSpecModbus::PrintBlock (block);
             filepath = SunSpecModbus::FormatModelPath (did_and_length[0]);
-            usleep(1000000);
+            usleep(query_delay_ * 1000);
         }
+        SunSpecModbus::SaveDeviceMap (device_map);
 
     } else {
         id_offset = 0;  // since the bms is the only not sunspec device 
         std::string filepath = SunSpecModbus::FormatModelPath (did);
         std::shared_ptr <SunSpecModel> model (
-            new SunSpecModel (did, id_offset, filepath)
+            new SunSpecModel (did, id_offset, filepath, cache_path_)
         );
         models_.push_back (std::move (model));
         std::map <std::string, std::string> block 
@@ -102,109 +164,232 @@ void SunSpecModbus::Query (unsigned int did) {
 
 }
 
+// Load Device Map
+// - read the cached model chain and verify it against the device by reading
+// - the did and length header of each cached model, one read each. Every
+// - header must match and the header after the last model must not have a
+// - model file, the same way Query ends the chain. The model blocks are not
+// - read, so the scale factors are updated later by the first ReadBlock or
+// - ReadValues, or by the first write that needs them.
+bool SunSpecModbus::LoadDeviceMap () {
+    if (cache_path_.empty ()) {
+        return false;
+    }
+    std::ifstream file (SunSpecModbus::DeviceMapPath ());
+    if (!file.is_open ()) {
+        return false;
+    }
+
+    std::vector <DeviceMapEntry> device_map;
+    std::string line;
+    while (std::getline (file, line)) {
+        if (line.empty () || line[0] == '#') {
+            continue;
+        }
+        std::stringstream ss (line);
+        DeviceMapEntry entry;
+        if (ss >> entry.did >> entry.header >> entry.length) {
+            device_map.push_back (entry);
+        }
+    }
+    if (device_map.empty ()) {
+        return false;
+    }
+
+    // only the did and length header of each model and the model after the
+    // chain are read, the SunSpec ID was already checked by the query
+    const unsigned int start = 40002;
+    bool valid = true;
+    unsigned int expected = start;
+    for (const auto& entry : device_map) {
+        uint16_t did_and_length[2];
+        valid = entry.header == expected
+            && entry.header + entry.length + 2 <= 0xFFFF
+            && SunSpecModbus::ReadRegisters (entry.header, 2, did_and_length)
+            && did_and_length[0] == entry.did
+            && did_and_length[1] == entry.length;
+        if (!valid) {
+            break;
+        }
+        expected = entry.header + entry.length + 2;
+    }
+    uint16_t end_model[2];
+    struct stat buffer;
+    valid = valid && SunSpecModbus::ReadRegisters (expected, 2, end_model)
+        && stat (SunSpecModbus::FormatModelPath (end_model[0]).c_str (),
+                 &buffer) != 0;
+    if (!valid) {
+        std::cout << "Device map changed, starting discovery" << std::endl;
+        return false;
+    }
+
+    for (const auto& entry : device_map) {
+        std::shared_ptr <SunSpecModel> model (new SunSpecModel (
+            entry.did, 
+            entry.header,
+            SunSpecModbus::FormatModelPath (entry.did),
+            cache_path_
+        ));
+        models_.push_back (std::move (model));
+    }
+    std::cout << "Device map loaded from cache: " 
+        << device_map.size () << " models" << std::endl;
+    return true;
+}
+
+// Save Device Map
+// - store the discovered model chain as one "did header length" per line
+void SunSpecModbus::SaveDeviceMap (
+    const std::vector <DeviceMapEntry>& device_map) {
+    if (cache_path_.empty () || device_map.empty ()) {
+        return;
+    }
+    std::string path = SunSpecModbus::DeviceMapPath ();
+    std::string temp_path = path + ".tmp";
+    std::ofstream file (temp_path, std::ios::trunc);
+    if (!file.is_open ()) {
+        std::cout << "[ERROR]\t" << "Save Device Map: " << temp_path << '\n';
+        return;
+    }
+    file << "# did header length\n";
+    for (const auto& entry : device_map) {
+        file << entry.did << ' ' << entry.header << ' ' << entry.length << '\n';
+    }
+    file.close ();
+    if (!file || std::rename (temp_path.c_str (), path.c_str ()) != 0) {
+        std::cout << "[ERROR]\t" << "Save Device Map: " << path << '\n';
+        std::remove (temp_path.c_str ());
+    }
+}
+
+// Device Map Path
+// - the device map is keyed by the ip, port and sunspec key of the device
+std::string SunSpecModbus::DeviceMapPath () {
+    std::stringstream ss;
+    ss << cache_path_ << "device_" << ip_ << "_" << port_ << "_" 
+        << sunspec_key_ << ".map";
+    return ss.str();
+}
+
 // Read Registers
 // - the register array is passed to the function as a pointer so the
-// - modbus method call can operate on them.
-void SunSpecModbus::ReadRegisters (unsigned int offset,
+// - modbus method call can operate on them. The registers are read in blocks
+// - of the devices max read size straight into the array. If any block fails
+// - the array is zeroed and false is returned.
+bool SunSpecModbus::ReadRegisters (unsigned int offset,
                                    unsigned int length,
                                    uint16_t* reg_ptr) {
-    unsigned int reg_left = length;
-    unsigned int new_offset = offset;
+    std::lock_guard <std::mutex> lock (context_mutex_);
+    unsigned int read = 0;
     int status;
-    std::vector <uint16_t> a_block;
 
-    // while the length of registers to read is greater than 100, read in each
-    // block of 100 and append to vector.
-    while (reg_left > 100) {
-        uint16_t partial_reg[100];
+    while (read < length) {
+        unsigned int count = std::min (length - read, max_read_);
         status = modbus_read_registers (context_ptr_,
-                                            new_offset,
-                                            100,
-                                            partial_reg);
+                                        offset + read,
+                                        count,
+                                        reg_ptr + read);
         if (status == -1) {
             std::cout << "[ERROR]\t"
-                << "Read Registers: " << modbus_strerror(errno) << '\n';
-                *reg_ptr = 0;
+                << "Read Registers: " << offset + read << " , "
+                << modbus_strerror(errno) << '\n';
+            memset (reg_ptr, 0, length * sizeof (uint16_t));
             status = modbus_flush(context_ptr_);
             if (status == -1) {
                 std::cout << "[ERROR]\t"
                     << "Modbus Flush: " << modbus_strerror(errno) << '\n';
                 modbus_flush(context_ptr_);
             }
+            return false;
         }
-
-        // convert raw registers to vector to pass to other functions
-        std::vector <uint16_t> b_block (partial_reg, partial_reg + 100);
-        a_block.insert(
-            std::end(a_block), std::begin(b_block), std::end(b_block)
-        );
-
-
-
-        // decrement registers left to read and increment offset to read the
-        // next block of registers
-        reg_left -= 100;
-        new_offset += 100;
+        read += count;
     }
-
-    // read remaining register block once less than 100
-    uint16_t partial_reg[reg_left];
-    status = modbus_read_registers (context_ptr_,
-                                        new_offset,
-                                        reg_left,
-                                        partial_reg);
-    if (status == -1) {
-        std::cout << "[ERROR]\t"
-            << "Read Registers: " << modbus_strerror(errno) << '\n';
-            *reg_ptr = 0;
-        status = modbus_flush(context_ptr_);
-        if (status == -1) {
-            std::cout << "[ERROR]\t"
-                << "Modbus Flush: " << modbus_strerror(errno) << '\n';
-            modbus_flush(context_ptr_);
-        }
-    }
-    // convert raw registers to vector to pass to other functions
-    std::vector <uint16_t> b_block (partial_reg, partial_reg + reg_left);
-    a_block.insert(
-        std::end(a_block), std::begin(b_block), std::end(b_block)
-    );
-
-    // copy full register block vector into the register array
-    memcpy(reg_ptr, &a_block.front (), a_block.size () * sizeof (uint16_t));
+    return true;
 }
 
 // Write Registers
-// - the registers to write are passed by reference to reduce memory
-void SunSpecModbus::WriteRegisters (unsigned int offset,
+// - write a contiguous register block using function code 16. The block is
+// - only split when it is larger than the devices maximum write size. A max
+// - write of 1 falls back to single register writes for devices that do not
+// - support function code 16. Returns false at the first failed request, the
+// - remaining registers are not written.
+bool SunSpecModbus::WriteRegisters (unsigned int offset,
                                     unsigned int length,
                                     std::vector <uint16_t> registers) {
+    std::lock_guard <std::mutex> lock (context_mutex_);
+    unsigned int reg_left = std::min (length, 
+        static_cast <unsigned int> (registers.size ()));
+    unsigned int written = 0;
     int status;
-    for (const auto& reg : registers) {
-        std::cout << "MB Write: " << offset << " , " << reg << std::endl;
-        status = modbus_write_register (context_ptr_, offset, reg);
+
+    while (reg_left > 0) {
+        unsigned int count = std::min (reg_left, max_write_);
+        if (count == 1) {
+            status = modbus_write_register (context_ptr_,
+                                            offset + written,
+                                            registers[written]);
+        } else {
+            status = modbus_write_registers (context_ptr_,
+                                             offset + written,
+                                             count,
+                                             &registers[written]);
+        }
 
         if (status == -1) {
-            std::cout << "[ERROR]\t"
-                << "Write Registers: " << modbus_strerror(errno) << '\n';
-            usleep(500000);
+            SunSpecModbus::LogError ("Write Registers: "
+                + std::to_string (offset + written) + " , "
+                + modbus_strerror (errno));
             modbus_flush(context_ptr_);
+            return false;
         }
-        offset++;
+        reg_left -= count;
+        written += count;
     }
+    return true;
+}
+
+// Write Register Map
+// - coalesce a sorted map of register address to value into contiguous
+// - blocks so each block is sent as a single write. Returns false at the
+// - first failed block, the remaining blocks are not written.
+bool SunSpecModbus::WriteRegisterMap (
+    const std::map <uint16_t, uint16_t>& registers) {
+    std::vector <uint16_t> block;
+    unsigned int start = 0;
+
+    for (const auto& reg : registers) {
+        if (!block.empty () && reg.first != start + block.size ()) {
+            if (!SunSpecModbus::WriteRegisters (start, block.size (), block)) {
+                return false;
+            }
+            block.clear ();
+        }
+        if (block.empty ()) {
+            start = reg.first;
+        }
+        block.push_back (reg.second);
+    }
+
+    if (!block.empty ()) {
+        return SunSpecModbus::WriteRegisters (start, block.size (), block);
+    }
+    return true;
 }
 
 std::map <std::string, std::string> SunSpecModbus::ReadBlock (unsigned int did){
-    for (const auto model : models_) {
+    for (const auto& model : models_) {
         if (*model == did) {
             // read register block
+            // a failed read returns an empty map so stale or uninitialized
+            // registers are never decoded
             unsigned int offset = model->GetOffset ();
             unsigned int length = model->GetLength ();
-            uint16_t raw[length];
-            SunSpecModbus::ReadRegisters (offset, length, raw);
+            std::vector <uint16_t> block (length);
+            if (!SunSpecModbus::ReadRegisters (offset, length, &block[0])) {
+                return std::map <std::string, std::string> ();
+            }
 
-            // convert raw registers to vector to pass to other functions
-            std::vector <uint16_t> block (raw, raw + length);
+            model->UpdateScalers (&block[0]);
             return model->BlockToPoints (block);
         }
     }
@@ -213,6 +398,52 @@ std::map <std::string, std::string> SunSpecModbus::ReadBlock (unsigned int did){
     return empty_map;
 }
 
+// Read Values
+// - typed version of ReadBlock. The values vector should be kept by the
+// - caller so it can be reused each read.
+bool SunSpecModbus::ReadValues (unsigned int did,
+                                std::vector <SunSpecModel::Value>* values) {
+    for (const auto& model : models_) {
+        if (*model == did) {
+            unsigned int offset = model->GetOffset ();
+            unsigned int length = model->GetLength ();
+            uint16_t raw[length];
+            if (!SunSpecModbus::ReadRegisters (offset, length, raw)) {
+                return false;
+            }
+            model->UpdateScalers (raw);
+            model->BlockToValues (raw, values);
+            return true;
+        }
+    }
+    std::cout << "[ERROR]\t" << "Read Values: model not found\n";
+    return false;
+}
+
+// Get Model
+// - returns the compiled model so point indexes can be resolved once
+std::shared_ptr <SunSpecModel> SunSpecModbus::GetModel (unsigned int did) {
+    for (const auto& model : models_) {
+        if (*model == did) {
+            return model;
+        }
+    }
+    return nullptr;
+}
+
+// Get Models
+// - returns all models found during the query in register order
+const std::vector <std::shared_ptr <SunSpecModel>>& 
+SunSpecModbus::GetModels () const {
+    return models_;
+}
+
+// Get Max Read
+// - returns the registers per read request
+unsigned int SunSpecModbus::GetMaxRead () const {
+    return max_read_;
+}
+
 void SunSpecModbus::WriteBlock (unsigned int did,
                                 std::map <std::string, std::string>& points) {
     for (const auto model : models_) {
@@ -225,20 +456,42 @@ void SunSpecModbus::WriteBlock (unsigned int did,
 // Write Point
 // - using the same format as writing a block, it will pass a string map
 // - to the points to register function and only write the desired registers
-void SunSpecModbus::WritePoint (unsigned int did,
+bool SunSpecModbus::WritePoint (unsigned int did,
                                 std::map <std::string, std::string>& point) {
-    for (const auto model : models_) {
+    return SunSpecModbus::WritePoints (did, point);
+}
+
+// Write Points
+// - write several points of one model as a single transaction. The points
+// - are encoded into one register map so adjacent and overlapping points are
+// - sent with as few modbus writes as possible. Points that can not be
+// - encoded are skipped and the rest are still written, false is returned if
+// - any point was skipped or a write failed.
+bool SunSpecModbus::WritePoints (unsigned int did,
+                                 std::map <std::string, std::string>& points) {
+    for (const auto& model : models_) {
         if (*model == did) {
-            // read register block
-            std::vector <uint16_t> registers = model->PointToRegisters (point);
-            unsigned int offset = registers[0];
-            unsigned int length = registers[1];
-            registers.erase (registers.begin(), registers.begin()+2);
-            SunSpecModbus::WriteRegisters(offset, length, registers);
-            return;
+            // a model loaded from the device map has not read its scale
+            // factors yet, they are needed to encode scaled points
+            if (!model->sunssf_read_ && !model->scalers_.empty ()
+                && !SunSpecModbus::RefreshScalers (*model)) {
+                SunSpecModbus::LogError ("Write Points: model "
+                    + std::to_string (did) + " scale factors not read");
+                return false;
+            }
+            std::map <uint16_t, uint16_t> registers;
+            bool encoded = model->PointsToRegisterMap (points, &registers);
+            if (!encoded) {
+                SunSpecModbus::LogError ("Write Points: model "
+                    + std::to_string (did) + " has points that can not be "
+                    + "encoded");
+            }
+            return SunSpecModbus::WriteRegisterMap (registers) && encoded;
         }
     }
-    std::cout << "[ERROR]\t" << "Write Point: model not found\n";
+    SunSpecModbus::LogError ("Write Points: model "
+        + std::to_string (did) + " not found");
+    return false;
 }
 
 std::string SunSpecModbus::FormatModelPath (unsigned int did) {
@@ -252,6 +505,29 @@ std::string SunSpecModbus::FormatModelPath (unsigned int did) {
     return ss.str();
 }
 
+// Refresh Scalers
+// - read the model block and store its scale factors
+bool SunSpecModbus::RefreshScalers (SunSpecModel& model) {
+    std::vector <uint16_t> block (model.GetLength ());
+    if (block.empty ()
+        || !SunSpecModbus::ReadRegisters (model.GetOffset (), block.size (),
+                                          &block[0])) {
+        return false;
+    }
+    model.UpdateScalers (&block[0]);
+    return true;
+}
+
+// Log Error
+// - write an error to the error log, or the terminal if there is no log path
+void SunSpecModbus::LogError (const std::string& message) {
+    if (log_path_.empty ()) {
+        std::cout << "[ERROR]\t" << message << '\n';
+    } else {
+        Logger ("ERROR", log_path_) << message;
+    }
+}
+
 void SunSpecModbus::PrintBlock (std::map <std::string, std::string>& block) {
     for (const auto& reg : block) {
         std::cout << reg.first << " : " << reg.second << std::endl;
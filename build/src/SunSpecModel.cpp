@@ -1,35 +1,138 @@
 #include <iostream>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
 #include <cmath>
+#include <cstdio>  // rename
+#include <cstring>
 #include <cctype>  // isdigit
 #include <bitset>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "include/SunSpecModel.h"
 
 namespace pt = boost::property_tree;
 
+// Pow 10
+// - sunssf values are a decimal place shift, so the common range is stored in
+// - a table to keep pow() out of the decode path.
+static float Pow10 (int16_t exponent) {
+    static const float kTable[] = {
+        1e-10f, 1e-9f, 1e-8f, 1e-7f, 1e-6f, 1e-5f, 1e-4f, 1e-3f, 1e-2f, 1e-1f,
+        1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+    };
+    if (exponent >= -10 && exponent <= 10) {
+        return kTable[exponent + 10];
+    }
+    return std::pow (10.0f, exponent);
+}
+
+// Get Raw
+// - combine the registers of a point the same way GetUINT32 does
+static uint32_t GetRaw (const uint16_t* block, const SunSpecModel::Point& p) {
+    if (p.length == 2) {
+        return (static_cast <uint32_t> (block[p.offset+1]) << 16)
+            | block[p.offset];
+    }
+    return block[p.offset];
+}
+
+// Compiled model cache
+// - the cache file is the compiled point table in a flat binary layout. It is
+// - mapped and copied into the point table, so a cached start skips the xml
+// - parse but still builds the table. The source file modify time and size
+// - are stored so an edited model is recompiled.
+// - layout: header | scalers | points | symbols | strings
+namespace {
+const char kCacheMagic[4] = {'S', 'M', 'D', 'X'};
+const uint32_t kCacheVersion = 1;
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t did;
+    uint32_t length;
+    int64_t source_mtime;
+    uint64_t source_size;
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t scalers;
+    uint32_t points;
+    uint32_t symbols;
+    uint32_t strings;
+};
+
+struct CachePoint {
+    uint32_t id_offset;
+    uint32_t id_length;
+    uint32_t symbol_begin;
+    uint32_t symbol_count;
+    float multiplier;
+    uint16_t offset;
+    uint16_t length;
+    int16_t scaler;
+    uint8_t type;
+    uint8_t pad;
+};
+
+struct CacheSymbol {
+    uint32_t value;
+    uint32_t name_offset;
+    uint32_t name_length;
+};
+
+// scalers are padded so the point records stay aligned
+size_t ScalerBytes (uint32_t scalers) {
+    return ((scalers * sizeof (uint16_t) + 7) / 8) * 8;
+}
+}  // namespace
+
 SunSpecModel::SunSpecModel (unsigned int did,
                             unsigned int offset,
-                            std::string model_path)
-    : offset_(offset) {
+                            std::string model_path,
+                            std::string cache_path)
+    : offset_(offset), sunssf_read_(false) {
     if (offset_ == 0 || offset_ == 30000 || offset_ == 40000) {
         // this is a fake sunspec device and I do not need to start after the
         // sunspec device code
     } else {
         offset_ += 2;
     }
-    // Use boosts xml parser to read file and store as member variable.
-    pt::xml_parser::read_xml(model_path, smdx_);
-    did_ = smdx_.get <unsigned int> ("sunSpecModels.model.<xmlattr>.id", 0);
+
     std::string name;
-    name = smdx_.get <std::string> ("sunSpecModels.model.<xmlattr>.name", "");
-    length_ = smdx_.get <unsigned int> ("sunSpecModels.model.<xmlattr>.len", 0);
+    std::string cache_file;
+    struct stat source;
+    bool has_source = (stat (model_path.c_str (), &source) == 0);
+    if (!cache_path.empty ()) {
+        std::stringstream ss;
+        ss << cache_path << "smdx_" << std::setfill ('0') << std::setw (5) 
+            << did << ".bin";
+        cache_file = ss.str ();
+    }
+
+    if (cache_file.empty () || !has_source 
+        || !SunSpecModel::LoadCache (cache_file, source, &name)) {
+        // Use boosts xml parser to read the file, then compile the points so
+        // the property tree does not need to be kept in memory.
+        pt::ptree smdx;
+        pt::xml_parser::read_xml(model_path, smdx);
+        did_ = smdx.get <unsigned int> ("sunSpecModels.model.<xmlattr>.id", 0);
+        name = smdx.get <std::string> ("sunSpecModels.model.<xmlattr>.name", "");
+        length_ = smdx.get <unsigned int> ("sunSpecModels.model.<xmlattr>.len", 0);
+        SunSpecModel::Compile (smdx);
+
+        if (!cache_file.empty () && has_source) {
+            SunSpecModel::SaveCache (cache_file, source, name);
+        }
+    }
 
     std::cout << "\n\tSunSpec Model Found"
         << "\n\t\tDID: " << did_
         << "\n\t\tName: " << name
         << "\n\t\tLength: " << length_ << std::endl;
-
-    SunSpecModel::GetScalers ();
 }
 
 SunSpecModel::~SunSpecModel() {
@@ -43,257 +146,577 @@ unsigned int SunSpecModel::GetLength () {
     return length_;
 };
 
-// Block To Points
-// - convert raw modbus register block to it's corresponding SunSpec points
-std::map <std::string, std::string> SunSpecModel::BlockToPoints (
-    const std::vector <uint16_t>& register_block) {
-    std::map <std::string, std::string> point_map;
-    std::string id, type, scaler;
-    unsigned int offset;
-
-     // Traverse property tree
-    BOOST_FOREACH (pt::ptree::value_type const& node,
-                   smdx_.get_child ("sunSpecModels.model.block")) {
-        pt::ptree subtree = node.second;
-        if( node.first == "point" ) {
-            id = subtree.get <std::string> ("<xmlattr>.id", "");
-            type = subtree.get <std::string> ("<xmlattr>.type", "");
-            scaler = subtree.get <std::string> ("<xmlattr>.sf", "default");
-            offset = subtree.get <unsigned int> ("<xmlattr>.offset", 0);
-
-            // TODO (TS): this should be configured by the smdx file
-            // - the scaled values are a decimal place shift so I use the
-            // - pow() function to raise 10 to the scale value for scaling.
-            if (type == "int16") {
-                int16_t value = register_block[offset];
-                if (sunssf_.count(scaler) == 0){
-                    float scale = SunSpecModel::BlockToScaler(
-                        register_block, scaler
-                    );
-                    if (std::isdigit (*scaler.c_str())) {
-                        scaler = id;
-                    }
-                    sunssf_[scaler] = scale;
-                }
+const std::vector <SunSpecModel::Point>& SunSpecModel::GetPoints () const {
+    return points_;
+};
 
-                value = value * sunssf_[scaler];
-                point_map[id] = std::to_string(value);
-            } else if (type == "uint16") {
-                uint16_t value = register_block[offset];
-                if (sunssf_.count(scaler) == 0){
-                    float scale = SunSpecModel::BlockToScaler(
-                        register_block, scaler
-                    );
-                    if (std::isdigit (*scaler.c_str())) {
-                        scaler = id;
-                    }
-                    sunssf_[scaler] = scale;
-                }
-                value = value * sunssf_[scaler];
-                point_map[id] = std::to_string(value);
-            } else if (type == "count") {
-                uint16_t value = register_block[offset];
-                if (sunssf_.count(scaler) == 0){
-                    float scale = SunSpecModel::BlockToScaler(
-                        register_block, scaler
-                    );
-                    if (std::isdigit (*scaler.c_str())) {
-                        scaler = id;
-                    }
-                    sunssf_[scaler] = scale;
-                }
+// Get Index
+// - returns the compiled point index for a point id or -1 if not found.
+// - consumers should look up indexes once and reuse them.
+int SunSpecModel::GetIndex (const std::string& id) const {
+    auto it = index_.find (id);
+    if (it == index_.end ()) {
+        return -1;
+    }
+    return it->second;
+};
 
-                std::cout << id << ": " << value << " , " << sunssf_[scaler] << std::endl;
-                value = value * sunssf_[scaler];
-                point_map[id] = std::to_string(value);
-            } else if (type == "acc16") {
-                uint16_t value = register_block[offset];
-                if (sunssf_.count(scaler) == 0){
-                    float scale = SunSpecModel::BlockToScaler(
-                        register_block, scaler
-                    );
-                    if (std::isdigit (*scaler.c_str())) {
-                        scaler = id;
-                    }
-                    sunssf_[scaler] = scale;
-                }
+// Compile
+// - walk the property tree once and store each point of the fixed block in
+// - a flat table. Scale factor names are resolved to sunssf indexes and the
+// - enum/bitfield symbols are stored with the point.
+void SunSpecModel::Compile (const pt::ptree& smdx) {
+    static const std::map <std::string, PointType> kTypes = {
+        {"int16", PointType::INT16},
+        {"uint16", PointType::UINT16},
+        {"count", PointType::COUNT},
+        {"acc16", PointType::ACC16},
+        {"int32", PointType::INT32},
+        {"uint32", PointType::UINT32},
+        {"float32", PointType::FLOAT32},
+        {"acc32", PointType::ACC32},
+        {"enum16", PointType::ENUM16},
+        {"enum32", PointType::ENUM32},
+        {"bitfield16", PointType::BITFIELD16},
+        {"bitfield32", PointType::BITFIELD32},
+        {"sunssf", PointType::SUNSSF},
+        {"string", PointType::STRING}
+    };
+    const pt::ptree& block = smdx.get_child ("sunSpecModels.model.block");
+
+    // the scale factors must be known before the points that reference them,
+    // a scale factor outside of the block is ignored so it is never read
+    std::map <std::string, int16_t> sunssf_index;
+    BOOST_FOREACH (pt::ptree::value_type const& node, block) {
+        if (node.first == "point"
+            && node.second.get <std::string> ("<xmlattr>.type", "") == "sunssf") {
+            std::string id = node.second.get <std::string> ("<xmlattr>.id");
+            uint16_t offset = node.second.get <uint16_t> ("<xmlattr>.offset");
+            if (offset >= length_) {
+                std::cout << "[ERROR]\t" << "Compile: " << id
+                    << " is outside of model " << did_ << '\n';
+                continue;
+            }
+            sunssf_index[id] = scalers_.size ();
+            scalers_.push_back (offset);
+        }
+    }
+    sunssf_.assign (scalers_.size (), 1);
 
-                value = value * sunssf_[scaler];
-                point_map[id] = std::to_string(value);
-            } else if (type == "int32") {
-                int32_t value = SunSpecModel::GetUINT32(register_block,offset);
-                if (sunssf_.count(scaler) == 0){
-                    float scale = SunSpecModel::BlockToScaler(
-                        register_block, scaler
-                    );
-                    if (std::isdigit (*scaler.c_str())) {
-                        scaler = id;
-                    }
-                    sunssf_[scaler] = scale;
-                }
+    BOOST_FOREACH (pt::ptree::value_type const& node, block) {
+        if (node.first != "point") {
+            continue;
+        }
+        const pt::ptree& subtree = node.second;
+        Point point;
+        point.id = subtree.get <std::string> ("<xmlattr>.id", "");
+        point.offset = subtree.get <uint16_t> ("<xmlattr>.offset", 0);
+        point.scaler = -1;
+        point.multiplier = 1;
+
+        std::string type = subtree.get <std::string> ("<xmlattr>.type", "");
+        auto type_it = kTypes.find (type);
+        point.type = (type_it == kTypes.end ()) 
+            ? PointType::UNSUPPORTED : type_it->second;
+
+        switch (point.type) {
+            case PointType::INT32:
+            case PointType::UINT32:
+            case PointType::FLOAT32:
+            case PointType::ACC32:
+            case PointType::ENUM32:
+            case PointType::BITFIELD32:
+                point.length = 2;
+                break;
+            case PointType::STRING:
+                point.length = subtree.get <uint16_t> ("<xmlattr>.len", 0);
+                break;
+            case PointType::UNSUPPORTED:
+                point.length = subtree.get <uint16_t> ("<xmlattr>.len", 1);
+                break;
+            default:
+                point.length = 1;
+                break;
+        }
 
-                value = value * sunssf_[scaler];
-                point_map[id] = std::to_string(value);
-            } else if (type == "float32") {
-                float value = SunSpecModel::GetUINT32(register_block,offset);
-                if (sunssf_.count(scaler) == 0){
-                    float scale = SunSpecModel::BlockToScaler(
-                        register_block, scaler
-                    );
-                    if (std::isdigit (*scaler.c_str())) {
-                        scaler = id;
-                    }
-                    sunssf_[scaler] = scale;
-                }
+        // points that run past the block can not be decoded, strings keep
+        // the registers that are inside of the block
+        if (point.offset + point.length > length_) {
+            if (point.type == PointType::STRING && point.offset < length_) {
+                point.length = length_ - point.offset;
+            } else {
+                point.type = PointType::UNSUPPORTED;
+            }
+        }
 
-                value = value * sunssf_[scaler];
-                point_map[id] = std::to_string(value);
-            } else if (type == "acc32") {
-                uint32_t value = SunSpecModel::GetUINT32(register_block,offset);
-                if (sunssf_.count(scaler) == 0){
-                    float scale = SunSpecModel::BlockToScaler(
-                        register_block, scaler
-                    );
-                    if (std::isdigit (*scaler.c_str())) {
-                        scaler = id;
-                    }
-                    sunssf_[scaler] = scale;
-                }
+        // TODO (TS): this should be configured by the smdx file
+        // - a leading digit is a non-sunspec multiplier hack, a negative
+        // - number is a fixed exponent, otherwise look for the sunssf point.
+        std::string scaler = subtree.get <std::string> ("<xmlattr>.sf", "");
+        if (scaler.empty ()) {
+            // default scale of 1
+        } else if (std::isdigit (scaler[0])) {
+            point.multiplier = std::stof (scaler);
+        } else if (scaler[0] == '-' && scaler.size () > 1 
+                   && std::isdigit (scaler[1])) {
+            point.multiplier = Pow10 (std::stoi (scaler));
+        } else if (sunssf_index.count (scaler) == 1) {
+            point.scaler = sunssf_index[scaler];
+        }
 
-                value = value * sunssf_[scaler];
-                point_map[id] = std::to_string(value);
-            } else if (type == "enum16") {
-                std::string reg = std::to_string(register_block[offset]);
-                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
-                               subtree.get_child("")){
-                    std::string label = subsubtree.first;
-                    if ( label != "<xmlattr>" ) {
-                        pt::ptree symbol = subsubtree.second;
-                        std::string value = symbol.data();
-                        if (value == reg) {
-                            std::string attr = symbol.get <std::string> (
-                                "<xmlattr>.id",""
-                            );
-                            point_map[id] = attr;
-                        }
-                    }
-                }
-            } else if (type == "enum32") {
-                std::string reg = std::to_string(
-                    SunSpecModel::GetUINT32(register_block,offset)
-                );
-                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
-                               subtree.get_child("")){
-                    std::string label = subsubtree.first;
-                    if ( label != "<xmlattr>" ) {
-                        pt::ptree symbol = subsubtree.second;
-                        std::string value = symbol.data();
-                        if (value == reg) {
-                            std::string attr = symbol.get <std::string> (
-                                "<xmlattr>.id",""
-                            );
-                            point_map[id] = attr;
-                        }
-                    }
-                }
-            } else if (type == "bitfield16") {
-                std::map <unsigned int, std::string> symbols;
-                std::string sym;
+        // collect enum and bitfield symbols
+        BOOST_FOREACH (pt::ptree::value_type const& symbol, subtree) {
+            if (symbol.first == "symbol") {
+                uint32_t value = std::stoul (symbol.second.data ());
+                std::string sym 
+                    = symbol.second.get <std::string> ("<xmlattr>.id", "");
+                point.symbols.emplace_back (value, sym);
+            }
+        }
 
-                // collect each bits symbol value
-                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
-                               subtree.get_child("")){
-                    std::string label = subsubtree.first;
-                    if ( label != "<xmlattr>" ) {
-                        pt::ptree symbol = subsubtree.second;
-                        unsigned int value = stoul(symbol.data());
-                        sym = symbol.get <std::string> (
-                            "<xmlattr>.id",""
-                        );
-                        symbols[value] = sym;
-                    }
+        index_[point.id] = points_.size ();
+        points_.push_back (std::move (point));
+    }
+};
+
+// Load Cache
+// - map the compiled model cache and rebuild the point table. Returns false if
+// - the cache is missing, corrupt, or older than the xml model.
+bool SunSpecModel::LoadCache (const std::string& cache_file,
+                              const struct stat& source,
+                              std::string* name) {
+    int fd = open (cache_file.c_str (), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat cache;
+    if (fstat (fd, &cache) == -1 
+        || cache.st_size < static_cast <off_t> (sizeof (CacheHeader))) {
+        close (fd);
+        return false;
+    }
+    size_t size = cache.st_size;
+    void* map = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    const char* base = static_cast <const char*> (map);
+    const CacheHeader* header = reinterpret_cast <const CacheHeader*> (base);
+    size_t scaler_start = sizeof (CacheHeader);
+    size_t point_start = scaler_start + ScalerBytes (header->scalers);
+    size_t symbol_start = point_start + header->points * sizeof (CachePoint);
+    size_t string_start = symbol_start + header->symbols * sizeof (CacheSymbol);
+    bool valid = memcmp (header->magic, kCacheMagic, 4) == 0
+        && header->version == kCacheVersion
+        && header->source_mtime == static_cast <int64_t> (source.st_mtime)
+        && header->source_size == static_cast <uint64_t> (source.st_size)
+        && string_start + header->strings == size
+        && header->name_offset + header->name_length <= header->strings;
+    if (!valid) {
+        munmap (map, size);
+        return false;
+    }
+
+    const uint16_t* scalers 
+        = reinterpret_cast <const uint16_t*> (base + scaler_start);
+    const CachePoint* points 
+        = reinterpret_cast <const CachePoint*> (base + point_start);
+    const CacheSymbol* symbols 
+        = reinterpret_cast <const CacheSymbol*> (base + symbol_start);
+    const char* strings = base + string_start;
+
+    did_ = header->did;
+    length_ = header->length;
+    name->assign (strings + header->name_offset, header->name_length);
+    scalers_.assign (scalers, scalers + header->scalers);
+    sunssf_.assign (scalers_.size (), 1);
+    for (const auto scaler : scalers_) {
+        valid = valid && scaler < length_;
+    }
+    points_.clear ();
+    index_.clear ();
+    points_.reserve (header->points);
+
+    for (uint32_t i = 0; i < header->points && valid; i++) {
+        const CachePoint& cached = points[i];
+        valid = cached.id_offset + cached.id_length <= header->strings
+            && cached.symbol_begin + cached.symbol_count <= header->symbols
+            && cached.type <= static_cast <uint8_t> (PointType::UNSUPPORTED)
+            && cached.scaler < static_cast <int16_t> (header->scalers)
+            && (cached.type == static_cast <uint8_t> (PointType::UNSUPPORTED)
+                || cached.offset + cached.length <= length_);
+        if (!valid) {
+            break;
+        }
+
+        Point point;
+        point.id.assign (strings + cached.id_offset, cached.id_length);
+        point.type = static_cast <PointType> (cached.type);
+        point.offset = cached.offset;
+        point.length = cached.length;
+        point.scaler = cached.scaler;
+        point.multiplier = cached.multiplier;
+        for (uint32_t j = 0; j < cached.symbol_count; j++) {
+            const CacheSymbol& symbol = symbols[cached.symbol_begin + j];
+            if (symbol.name_offset + symbol.name_length > header->strings) {
+                valid = false;
+                break;
+            }
+            point.symbols.emplace_back (symbol.value, std::string (
+                strings + symbol.name_offset, symbol.name_length
+            ));
+        }
+        index_[point.id] = points_.size ();
+        points_.push_back (std::move (point));
+    }
+    munmap (map, size);
+
+    if (!valid) {
+        points_.clear ();
+        index_.clear ();
+        scalers_.clear ();
+        sunssf_.clear ();
+    }
+    return valid;
+};
+
+// Save Cache
+// - write the compiled point table to the cache file. The file is written
+// - to a temporary name first so a partial write is never loaded.
+void SunSpecModel::SaveCache (const std::string& cache_file,
+                              const struct stat& source,
+                              const std::string& name) {
+    std::vector <CachePoint> points;
+    std::vector <CacheSymbol> symbols;
+    std::string strings = name;
+
+    for (const auto& point : points_) {
+        CachePoint cached;
+        memset (&cached, 0, sizeof (cached));
+        cached.id_offset = strings.size ();
+        cached.id_length = point.id.size ();
+        strings += point.id;
+        cached.symbol_begin = symbols.size ();
+        cached.symbol_count = point.symbols.size ();
+        cached.multiplier = point.multiplier;
+        cached.offset = point.offset;
+        cached.length = point.length;
+        cached.scaler = point.scaler;
+        cached.type = static_cast <uint8_t> (point.type);
+        for (const auto& symbol : point.symbols) {
+            CacheSymbol cached_symbol;
+            cached_symbol.value = symbol.first;
+            cached_symbol.name_offset = strings.size ();
+            cached_symbol.name_length = symbol.second.size ();
+            strings += symbol.second;
+            symbols.push_back (cached_symbol);
+        }
+        points.push_back (cached);
+    }
+
+    CacheHeader header;
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, kCacheMagic, 4);
+    header.version = kCacheVersion;
+    header.did = did_;
+    header.length = length_;
+    header.source_mtime = source.st_mtime;
+    header.source_size = source.st_size;
+    header.name_offset = 0;
+    header.name_length = name.size ();
+    header.scalers = scalers_.size ();
+    header.points = points.size ();
+    header.symbols = symbols.size ();
+    header.strings = strings.size ();
+
+    std::vector <char> scalers (ScalerBytes (header.scalers), 0);
+    if (!scalers_.empty ()) {
+        memcpy (&scalers[0], &scalers_[0], scalers_.size () * sizeof (uint16_t));
+    }
+
+    std::string temp_file = cache_file + ".tmp";
+    std::ofstream file (temp_file, std::ios::binary | std::ios::trunc);
+    if (!file.is_open ()) {
+        std::cout << "[ERROR]\t" << "Save Cache: " << temp_file << '\n';
+        return;
+    }
+    file.write (reinterpret_cast <const char*> (&header), sizeof (header));
+    file.write (scalers.data (), scalers.size ());
+    file.write (reinterpret_cast <const char*> (points.data ()),
+                points.size () * sizeof (CachePoint));
+    file.write (reinterpret_cast <const char*> (symbols.data ()),
+                symbols.size () * sizeof (CacheSymbol));
+    file.write (strings.data (), strings.size ());
+    file.close ();
+
+    if (!file || std::rename (temp_file.c_str (), cache_file.c_str ()) != 0) {
+        std::cout << "[ERROR]\t" << "Save Cache: " << cache_file << '\n';
+        std::remove (temp_file.c_str ());
+    }
+};
+
+// Block To Values
+// - decode a raw modbus register block into the typed values array. The
+// - values vector is reused between calls so it is only resized the first
+// - time, after that the decode does not allocate.
+void SunSpecModel::BlockToValues (const uint16_t* register_block,
+                                  std::vector <Value>* values) const {
+    std::vector <Value>& deref_values = *values;
+    deref_values.resize (points_.size ());
+
+    for (unsigned int i = 0; i < points_.size (); i++) {
+        const Point& point = points_[i];
+        Value& value = deref_values[i];
+        if (point.type == PointType::STRING 
+            || point.type == PointType::UNSUPPORTED) {
+            value.raw = 0;
+            value.scaled = 0;
+            continue;
+        }
+
+        value.raw = GetRaw (register_block, point);
+        float scale = point.multiplier;
+        if (point.scaler >= 0) {
+            scale = Pow10 (
+                static_cast <int16_t> (register_block[scalers_[point.scaler]])
+            );
+        }
+
+        switch (point.type) {
+            case PointType::INT16:
+            case PointType::SUNSSF:
+                value.scaled = static_cast <int16_t> (value.raw) * scale;
+                break;
+            case PointType::INT32:
+                value.scaled = static_cast <int32_t> (value.raw) * scale;
+                break;
+            default:
+                value.scaled = value.raw * scale;
+                break;
+        }
+    }
+};
+
+// Value To Symbol
+// - returns the enum symbol of the value, or an empty string if the value
+// - does not match a symbol.
+const std::string& SunSpecModel::ValueToSymbol (unsigned int index,
+                                                const Value& value) const {
+    static const std::string kEmpty;
+    for (const auto& symbol : points_[index].symbols) {
+        if (symbol.first == value.raw) {
+            return symbol.second;
+        }
+    }
+    return kEmpty;
+};
+
+// Value To String
+// - format a decoded value the same way the string map has always presented
+// - it. Strings need the register block so they are handled by BlockToPoints
+std::string SunSpecModel::ValueToString (unsigned int index,
+                                         const Value& value) const {
+    const Point& point = points_[index];
+    switch (point.type) {
+        case PointType::ENUM16:
+        case PointType::ENUM32:
+            return SunSpecModel::ValueToSymbol (index, value);
+        case PointType::BITFIELD16:
+        case PointType::BITFIELD32: {
+            // for each bit add symbol if it is set
+            std::string sym;
+            for (const auto& symbol : point.symbols) {
+                if (symbol.first < 32 && (value.raw >> symbol.first) & 1) {
+                    sym = sym + symbol.second + ",";
                 }
+            }
+            if (!sym.empty()) {
+                sym.pop_back ();  // remove last comma
+            }
+            return sym;
+        }
+        case PointType::SUNSSF:
+            return std::to_string (static_cast <int16_t> (value.raw));
+        case PointType::STRING:
+        case PointType::UNSUPPORTED:
+            return "";
+        default:
+            // unscaled points keep their integer representation
+            if (point.scaler < 0 && point.multiplier == 1) {
+                if (point.type == PointType::INT16) {
+                    return std::to_string (static_cast <int16_t> (value.raw));
+                } else if (point.type == PointType::INT32) {
+                    return std::to_string (static_cast <int32_t> (value.raw));
+                }
+                return std::to_string (value.raw);
+            }
+            return std::to_string (value.scaled);
+    }
+};
 
-                if (!symbols.empty()) {
-                    sym.clear();
+// Update Scalers
+// - store the scale factors of the block so points can be written using the
+// - last values read from the device.
+void SunSpecModel::UpdateScalers (const uint16_t* register_block) {
+    for (unsigned int i = 0; i < scalers_.size (); i++) {
+        sunssf_[i] = Pow10 (static_cast <int16_t> (register_block[scalers_[i]]));
+    }
+    sunssf_read_ = true;
+};
 
-                    // for each bit add symbol if it is set;
-                    std::bitset<16> bits (register_block[offset]);
-                    for (unsigned int i = 0; i < 16; i++) {
-                        if (bits[i] && symbols.count (i) == 1) {
-                            sym = sym + symbols[i] + ",";
-                        }
-                    }
-                    if (!sym.empty()) {
-                        sym.pop_back ();  // remove last comma
+// Block To Points
+// - convert raw modbus register block to it's corresponding SunSpec points
+// - this is the string view of BlockToValues and keeps the format of the
+// - original parser: scaled integers are truncated to the point type, only
+// - float32 has decimals, uint32 points are not reported and bitfields only
+// - report the first 16 bits.
+std::map <std::string, std::string> SunSpecModel::BlockToPoints (
+    const std::vector <uint16_t>& register_block) {
+    std::map <std::string, std::string> point_map;
+    std::vector <Value> values;
+    SunSpecModel::BlockToValues (&register_block[0], &values);
+
+    for (unsigned int i = 0; i < points_.size (); i++) {
+        const Point& point = points_[i];
+        const Value& value = values[i];
+        switch (point.type) {
+            case PointType::INT16:
+                point_map[point.id] = std::to_string (static_cast <int16_t> (
+                    static_cast <int32_t> (value.scaled)
+                ));
+                break;
+            case PointType::UINT16:
+            case PointType::COUNT:
+            case PointType::ACC16:
+                point_map[point.id] = std::to_string (static_cast <uint16_t> (
+                    static_cast <int32_t> (value.scaled)
+                ));
+                break;
+            case PointType::INT32:
+                point_map[point.id] = std::to_string (
+                    static_cast <int32_t> (value.scaled)
+                );
+                break;
+            case PointType::ACC32:
+                point_map[point.id] = std::to_string (
+                    static_cast <uint32_t> (value.scaled)
+                );
+                break;
+            case PointType::FLOAT32:
+                point_map[point.id] = std::to_string (value.scaled);
+                break;
+            case PointType::SUNSSF:
+                point_map[point.id] = std::to_string (
+                    static_cast <int16_t> (value.raw)
+                );
+                break;
+            case PointType::ENUM16:
+            case PointType::ENUM32:
+                // only found symbols are added, the last match wins
+                for (const auto& symbol : point.symbols) {
+                    if (symbol.first == value.raw) {
+                        point_map[point.id] = symbol.second;
                     }
-                    point_map[id] = sym;
-                } else {
-                    point_map[id] = "";
                 }
-            } else if (type == "bitfield32") {
-                std::map <unsigned int, std::string> symbols;
+                break;
+            case PointType::BITFIELD16:
+            case PointType::BITFIELD32: {
+                // for each bit add symbol if it is set
                 std::string sym;
-
-                // collect each bits symbol value
-                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
-                               subtree.get_child("")){
-                    std::string label = subsubtree.first;
-                    if ( label != "<xmlattr>" ) {
-                        pt::ptree symbol = subsubtree.second;
-                        unsigned int value = stoul(symbol.data());
-                        sym = symbol.get <std::string> (
-                            "<xmlattr>.id",""
-                        );
-                        symbols[value] = sym;
+                for (unsigned int bit = 0; bit < 16; bit++) {
+                    if (((value.raw >> bit) & 1) == 0) {
+                        continue;
                     }
-                }
-                
-
-                if (!symbols.empty()) {
-                    sym.clear();
-
-                    // for each bit add symbol if it is set;
-                    std::bitset<32> bits (
-                        SunSpecModel::GetUINT32(register_block, offset)
-                    );
-                    for (unsigned int i = 0; i < 16; i++) {
-                        if (bits[i] && symbols.count (i) == 1) {
-                            sym = sym + symbols[i] + ",";
+                    const std::string* name = nullptr;
+                    for (const auto& symbol : point.symbols) {
+                        if (symbol.first == bit) {
+                            name = &symbol.second;
                         }
                     }
-                    if (!sym.empty()) {
-                        sym.pop_back ();  // remove last comma
+                    if (name) {
+                        sym = sym + *name + ",";
                     }
-                    point_map[id] = sym;
-                } else {
-                    point_map[id] = "";
                 }
-            } else if (type == "sunssf") {
-                int16_t value = register_block[offset];
-                point_map[id] = std::to_string(value);
-            } else if (type == "string") {
-                unsigned int length;
-                length = subtree.get <unsigned int> ("<xmlattr>.len", 0);
-                std::string value = SunSpecModel::GetString (
-                    register_block, offset, length
-                );
-                point_map[id] = value;
-            } else if (type == "pad") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "ipaddr") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "ipv6addr") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "eui48") {
-                //TODO (TS): determine how this value is implemented.
+                if (!sym.empty()) {
+                    sym.pop_back ();  // remove last comma
+                }
+                point_map[point.id] = sym;
+                break;
             }
+            case PointType::STRING:
+                point_map[point.id] = SunSpecModel::GetString (
+                    register_block, point.offset, point.length
+                );
+                break;
+            case PointType::UINT32:
+            case PointType::UNSUPPORTED:
+                //TODO (TS): determine how pad, ipaddr, ipv6addr, eui48 and
+                // - 64 bit values are implemented.
+                break;
         }
     }
 
     return point_map;
 };
 
+// Encode Point
+// - convert a point value string into the registers it occupies. Returns
+// - false if the point type can not be written.
+bool SunSpecModel::EncodePoint (const Point& point,
+                                const std::string& value,
+                                uint16_t* registers) const {
+    float scale = point.multiplier;
+    if (point.scaler >= 0) {
+        scale = sunssf_[point.scaler];
+    }
+
+    switch (point.type) {
+        case PointType::INT16:
+            registers[0] = static_cast <int16_t> (
+                std::lround (std::stof (value) / scale)
+            );
+            return true;
+        case PointType::UINT16:
+        case PointType::COUNT:
+        case PointType::ACC16:
+            registers[0] = static_cast <uint16_t> (
+                std::lround (std::stof (value) / scale)
+            );
+            return true;
+        case PointType::INT32:
+        case PointType::UINT32:
+        case PointType::FLOAT32:
+        case PointType::ACC32: {
+            uint32_t raw = static_cast <uint32_t> (
+                std::llround (std::stof (value) / scale)
+            );
+            registers[1] = static_cast <uint16_t> (raw >> 16);
+            registers[0] = static_cast <uint16_t> (raw);
+            return true;
+        }
+        case PointType::ENUM16:
+        case PointType::ENUM32:
+            for (const auto& symbol : point.symbols) {
+                if (symbol.second == value) {
+                    registers[0] = static_cast <uint16_t> (symbol.first);
+                    if (point.length == 2) {
+                        registers[1] = static_cast <uint16_t> (
+                            symbol.first >> 16
+                        );
+                    }
+                    return true;
+                }
+            }
+            std::cout << "[ERROR]\t" << "Encode Point: invalid symbol "
+                << value << " for " << point.id << '\n';
+            return false;
+        default:
+            //TODO (TS): I don't believe these values can be written to
+            return false;
+    }
+};
 
 // Points To Block
 // - translated sunspec points into register block for writing to device
@@ -302,82 +725,15 @@ std::map <std::string, std::string> SunSpecModel::BlockToPoints (
 std::vector <uint16_t> SunSpecModel::PointsToBlock (
     std::map <std::string, std::string>& points) {
     std::vector <uint16_t> register_block (length_, 0);  // initialize block
-    std::string id, type, scaler;
-    unsigned int offset;
-
-     // Traverse property tree
-    BOOST_FOREACH (pt::ptree::value_type const& node,
-                   smdx_.get_child ("sunSpecModels.model.block")) {
-        pt::ptree subtree = node.second;
-        if( node.first == "point" ) {
-            id = subtree.get <std::string> ("<xmlattr>.id", "");
-            type = subtree.get <std::string> ("<xmlattr>.type", "");
-            scaler = subtree.get <std::string> ("<xmlattr>.sf", "default");
-            offset = subtree.get <unsigned int> ("<xmlattr>.offset", 0);
-
-            // if the point is not in the model, then skip
-            if (points.count(id) == 0) {
-                continue;
-            }
-            // TODO (TS): this should be configured by the smdx file
-            if (type == "int16") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                register_block[offset] = value / scale;
-            } else if (type == "uint16") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                register_block[offset] = value / scale;
-            } else if (type == "count") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                register_block[offset] = value / scale;
-            } else if (type == "acc16") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                register_block[offset] = value / scale;
-            } else if (type == "int32") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                value = value / scale;
-                SunSpecModel::SetUINT32(&register_block,offset, value);
-            } else if (type == "float32") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                value = value / scale;
-                SunSpecModel::SetUINT32(&register_block,offset, value);
-            } else if (type == "acc32") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                value = value / scale;
-                SunSpecModel::SetUINT32(&register_block,offset, value);
-            } else if (type == "enum16") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "enum32") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "bitfield16") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "bitfield32") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "string") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "pad") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "ipaddr") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "ipv6addr") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "eui48") {
-                //TODO (TS): determine how this value is implemented.
-            }
+
+    for (const auto& point : points_) {
+        // if the point is not in the model, then skip
+        if (points.count(point.id) == 0) {
+            continue;
         }
+        SunSpecModel::EncodePoint (
+            point, points[point.id], &register_block[point.offset]
+        );
     }
 
     return register_block;
@@ -389,153 +745,55 @@ std::vector <uint16_t> SunSpecModel::PointsToBlock (
 // - offset/length of the registers to be written to.
 std::vector <uint16_t> SunSpecModel::PointToRegisters (
     std::map <std::string, std::string>& point) {
-    std::string id, type, scaler;
-    unsigned int offset;
-
-     // Traverse property tree
-    BOOST_FOREACH (pt::ptree::value_type const& node,
-                   smdx_.get_child ("sunSpecModels.model.block")) {
-        pt::ptree subtree = node.second;
-        if( node.first == "point" ) {
-            id = subtree.get <std::string> ("<xmlattr>.id", "");
-
-            // skip other type checks if id does not match point
-            if (point.count(id) == 0) {
-                continue;
-            }
+    for (const auto& entry : point) {
+        int index = SunSpecModel::GetIndex (entry.first);
+        if (index < 0) {
+            continue;
+        }
 
-            type = subtree.get <std::string> ("<xmlattr>.type", "");
-            scaler = subtree.get <std::string> ("<xmlattr>.sf", "default");
-            offset = subtree.get <unsigned int> ("<xmlattr>.offset", 0);
-            uint16_t index = offset_ + offset;
-
-            // TODO (TS): this should be configured by the smdx file
-            if (type == "int16") {
-                uint16_t value = std::stoi(point[id]);
-                value = value / sunssf_[scaler];
-                std::vector <uint16_t> registers = {index, 1, value};
-                return registers;
-            } else if (type == "uint16") {
-                uint16_t value = std::stoul(point[id]);
-                value = value / sunssf_[scaler];
-                std::vector <uint16_t> registers = {index, 1, value};
-                return registers;
-            } else if (type == "count") {
-                uint16_t value = std::stoul(point[id]);
-                value = value / sunssf_[scaler];
-                std::vector <uint16_t> registers = {index, 1, value};
-                return registers;
-            } else if (type == "acc16") {
-                uint16_t value = std::stoul(point[id]);
-                value = value / sunssf_[scaler];
-                std::vector <uint16_t> registers = {index, 1, value};
-                return registers;
-            } else if (type == "int32") {
-                uint32_t value = std::stoi(point[id]);
-                value = value / sunssf_[scaler];
-                std::vector <uint16_t> registers = {index, 1, 0, 0};
-                SunSpecModel::SetUINT32(&registers, 2, value);
-                return registers;
-            } else if (type == "float32") {
-                uint32_t value = std::stoul(point[id]);
-                value = value / sunssf_[scaler];
-                std::vector <uint16_t> registers = {index, 1, 0, 0};
-                SunSpecModel::SetUINT32(&registers, 2, value);
-                return registers;
-            } else if (type == "acc32") {
-                uint32_t value = std::stoul(point[id]);
-                value = value / sunssf_[scaler];
-                std::vector <uint16_t> registers = {index, 1, 0, 0};
-                SunSpecModel::SetUINT32(&registers, 2, value);
-                return registers;
-            } else if (type == "enum16") {
-                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
-                               subtree.get_child("")){
-                    std::string label = subsubtree.first;
-                    if ( label != "<xmlattr>" ) {
-                        pt::ptree symbol = subsubtree.second;
-                        std::string attr = symbol.get <std::string> (
-                            "<xmlattr>.id",""
-                        );
-                        if (attr == point[id]) {
-                            uint16_t value = std::stoul(symbol.data());
-                            std::cout << attr << ": " << value << std::endl;
-                            std::vector <uint16_t> registers = {index,1,value};
-                            return registers;
-                        }
-                    }
-                }
-            } else if (type == "enum32") {
-                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
-                               subtree.get_child("")){
-                    std::string label = subsubtree.first;
-                    if ( label != "<xmlattr>" ) {
-                        pt::ptree symbol = subsubtree.second;
-                        std::string attr = symbol.get <std::string> (
-                            "<xmlattr>.id",""
-                        );
-                        if (attr == point[id]) {
-                            uint32_t value = std::stoul(symbol.data());
-                            std::cout << attr << ": " << value << std::endl;
-                            std::vector <uint16_t> registers = {index,2,value};
-                            SunSpecModel::SetUINT32(&registers, 2, value);
-                            return registers;
-                        }
-                    }
-                }
-            } else if (type == "bitfield16") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "bitfield32") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "string") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "pad") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "ipaddr") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "ipv6addr") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "eui48") {
-                //TODO (TS): determine how this value is implemented.
-            }
+        const Point& compiled = points_[index];
+        std::vector <uint16_t> registers (2 + compiled.length, 0);
+        registers[0] = offset_ + compiled.offset;
+        registers[1] = compiled.length;
+        if (SunSpecModel::EncodePoint (compiled, entry.second, &registers[2])) {
+            return registers;
         }
     }
     std::vector <uint16_t> registers;
     return registers;
 };
 
-void SunSpecModel::GetScalers() {
-    scalers_["default"] = 0;
-     // Traverse property tree
-    BOOST_FOREACH (pt::ptree::value_type const& node,
-                   smdx_.get_child ("sunSpecModels.model.block")) {
-        pt::ptree subtree = node.second;
-        std::string id;
-        unsigned int offset;
-        if( node.first == "point" ) {
-
-            if (subtree.get <std::string> ("<xmlattr>.type") == "sunssf") {
-                id = subtree.get <std::string> ("<xmlattr>.id");
-                offset = subtree.get <int> ("<xmlattr>.offset");
-                scalers_[id] = offset;
-            }
+// Points To Register Map
+// - encode several points of the model into a map of absolute register
+// - address to value. Points that share registers overwrite in map order so
+// - the caller can coalesce the sorted addresses into block writes.
+bool SunSpecModel::PointsToRegisterMap (
+    std::map <std::string, std::string>& points,
+    std::map <uint16_t, uint16_t>* registers) {
+    std::map <uint16_t, uint16_t>& deref_registers = *registers;
+    bool valid = true;
+
+    for (const auto& entry : points) {
+        int index = SunSpecModel::GetIndex (entry.first);
+        if (index < 0) {
+            std::cout << "[ERROR]\t" << "Points To Register Map: "
+                << entry.first << " not found in model " << did_ << '\n';
+            valid = false;
+            continue;
         }
-    }
-};
 
-// Block To Scaler
-// - this function is just a hack to get non-sunspec complient devices to be
-// - interpreted.
-float SunSpecModel::BlockToScaler (const std::vector <uint16_t>& register_block,
-                                   std::string scaler) {
-    if (std::isdigit (*scaler.c_str())) {
-        return std::stof(scaler);
-    } else if (scaler == "default") {
-        return 1;
-    } else {
-        int16_t sf = register_block[scalers_[scaler]];
-        return std::pow(10, sf);
+        const Point& point = points_[index];
+        uint16_t encoded[2] = {0, 0};
+        if (point.length > 2 
+            || !SunSpecModel::EncodePoint (point, entry.second, encoded)) {
+            valid = false;
+            continue;
+        }
+        for (unsigned int i = 0; i < point.length; i++) {
+            deref_registers[offset_ + point.offset + i] = encoded[i];
+        }
     }
+    return valid;
 };
 
 // Point To Scaler
@@ -0,0 +1,341 @@
+// INCLUDES
+#include <iostream>
+#include <algorithm>
+#include "include/SunSpecPoller.h"
+
+const uint32_t SunSpecPoller::kNeverRead;
+
+// Now Milliseconds
+// - steady clock milliseconds used for the snapshot timestamps
+static int64_t NowMilliseconds () {
+    return std::chrono::duration_cast <std::chrono::milliseconds> (
+        std::chrono::steady_clock::now ().time_since_epoch ()
+    ).count ();
+}
+
+// Constructor
+// - map each model of the device into a single snapshot image so registers
+// - can be published by address.
+SunSpecPoller::SunSpecPoller (SunSpecModbus* device_ptr, unsigned int max_gap)
+    : device_ptr_(device_ptr),
+      max_gap_(max_gap),
+      sequence_(0),
+      image_size_(0),
+      running_(false) {
+    for (const auto& model : device_ptr_->GetModels ()) {
+        Region region;
+        region.did = model->did_;
+        region.address = model->GetOffset ();
+        region.length = model->GetLength ();
+        region.image = image_size_;
+        region.model = model;
+        regions_.push_back (region);
+        image_size_ += region.length;
+    }
+
+    image_.reset (new std::atomic <uint16_t>[image_size_]);
+    stamps_.reset (new std::atomic <int64_t>[image_size_]);
+    for (unsigned int i = 0; i < image_size_; i++) {
+        image_[i].store (0, std::memory_order_relaxed);
+        stamps_[i].store (0, std::memory_order_relaxed);
+    }
+}  // end constructor
+
+SunSpecPoller::~SunSpecPoller () {
+    SunSpecPoller::Stop ();
+}  // end destructor
+
+// Subscribe
+// - add a point that should be refreshed at the given interval. The points
+// - scale factor register is polled with it so the value can be decoded.
+bool SunSpecPoller::Subscribe (unsigned int did,
+                               const std::string& id,
+                               unsigned int interval_ms) {
+    const Region* region = SunSpecPoller::FindRegion (did);
+    if (region == nullptr) {
+        std::cout << "[ERROR]\t" << "Subscribe: model not found " << did << '\n';
+        return false;
+    }
+
+    int index = region->model->GetIndex (id);
+    if (index < 0) {
+        std::cout << "[ERROR]\t" << "Subscribe: point not found " << id << '\n';
+        return false;
+    }
+
+    const SunSpecModel::Point& point = region->model->GetPoints ()[index];
+    Subscription subscription;
+    subscription.address = region->address + point.offset;
+    subscription.length = point.length;
+    subscription.scaler = -1;
+    if (point.scaler >= 0) {
+        subscription.scaler = region->address
+            + region->model->scalers_[point.scaler];
+    }
+    subscription.interval = std::chrono::milliseconds (interval_ms);
+    subscription.next_due = std::chrono::steady_clock::now ();
+    subscriptions_.push_back (subscription);
+    return true;
+}  // end Subscribe
+
+// Start
+// - spawn the polling thread
+void SunSpecPoller::Start () {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread (&SunSpecPoller::Run, this);
+}  // end Start
+
+// Stop
+// - signal the polling thread and wait for the current poll to finish. Writes
+// - that are still queued are sent before returning.
+void SunSpecPoller::Stop () {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard <std::mutex> lock (wait_mutex_);
+        running_ = false;
+    }
+    wait_.notify_all ();
+    if (thread_.joinable ()) {
+        thread_.join ();
+    }
+    SunSpecPoller::FlushWrites ();
+}  // end Stop
+
+// Run
+// - write then poll and sleep until the next subscription is due or a write
+// - is queued
+void SunSpecPoller::Run () {
+    while (running_) {
+        SunSpecPoller::FlushWrites ();
+        SunSpecPoller::Poll ();
+
+        auto next = std::chrono::steady_clock::now () + std::chrono::seconds (1);
+        for (const auto& subscription : subscriptions_) {
+            next = std::min (next, subscription.next_due);
+        }
+
+        std::unique_lock <std::mutex> lock (wait_mutex_);
+        wait_.wait_until (lock, next, [this]() {
+            return !running_ || !writes_.empty ();
+        });
+    }
+}  // end Run
+
+// Write Points
+// - queue the points for the polling thread. A model that already has a
+// - queued write is merged into it so a slow device does not grow the queue,
+// - the newest value of a point wins.
+bool SunSpecPoller::WritePoints (
+    unsigned int did, const std::map <std::string, std::string>& points) {
+    if (SunSpecPoller::FindRegion (did) == nullptr) {
+        std::cout << "[ERROR]\t" << "Write Points: model not found " << did
+            << '\n';
+        return false;
+    }
+
+    {
+        std::lock_guard <std::mutex> lock (wait_mutex_);
+        if (running_) {
+            for (auto& write : writes_) {
+                if (write.did == did) {
+                    for (const auto& point : points) {
+                        write.points[point.first] = point.second;
+                    }
+                    return true;
+                }
+            }
+            writes_.push_back ({did, points});
+            wait_.notify_all ();
+            return true;
+        }
+    }
+
+    std::map <std::string, std::string> copy = points;
+    return device_ptr_->WritePoints (did, copy);
+}  // end Write Points
+
+// Flush Writes
+// - send the queued writes in order. The device logs a failed write and the
+// - rest of the queue is dropped since it was meant to follow it, the control
+// - loop will queue the writes again.
+void SunSpecPoller::FlushWrites () {
+    std::vector <PendingWrite> writes;
+    {
+        std::lock_guard <std::mutex> lock (wait_mutex_);
+        writes.swap (writes_);
+    }
+
+    for (unsigned int i = 0; i < writes.size (); i++) {
+        if (!device_ptr_->WritePoints (writes[i].did, writes[i].points)) {
+            if (i + 1 < writes.size ()) {
+                std::cout << "[ERROR]\t" << "Flush Writes: dropped "
+                    << writes.size () - i - 1 << " queued writes\n";
+            }
+            return;
+        }
+    }
+}  // end Flush Writes
+
+// Poll
+// - read every register that is due in as few reads as possible and publish
+// - them to the snapshot. Ranges are merged when the unused registers between
+// - them are within the max gap and the read fits in one modbus request.
+void SunSpecPoller::Poll () {
+    auto now = std::chrono::steady_clock::now ();
+    std::vector <std::pair <unsigned int, unsigned int>> ranges;
+
+    for (auto& subscription : subscriptions_) {
+        if (subscription.next_due > now) {
+            continue;
+        }
+        ranges.emplace_back (subscription.address, subscription.length);
+        if (subscription.scaler >= 0) {
+            ranges.emplace_back (subscription.scaler, 1);
+        }
+
+        // keep the interval phase unless the poll fell behind
+        subscription.next_due += subscription.interval;
+        if (subscription.next_due <= now) {
+            subscription.next_due = now + subscription.interval;
+        }
+    }
+    if (ranges.empty ()) {
+        return;
+    }
+
+    // merge sorted ranges
+    std::sort (ranges.begin (), ranges.end ());
+    std::vector <std::pair <unsigned int, unsigned int>> reads;
+    unsigned int max_read = device_ptr_->GetMaxRead ();
+    for (const auto& range : ranges) {
+        if (!reads.empty ()) {
+            auto& last = reads.back ();
+            unsigned int last_end = last.first + last.second;
+            unsigned int end = std::max (last_end, range.first + range.second);
+            if (range.first <= last_end + max_gap_
+                && end - last.first <= max_read) {
+                last.second = end - last.first;
+                continue;
+            }
+        }
+        reads.push_back (range);
+    }
+
+    // read all ranges before publishing so the snapshot is only locked for
+    // the copy and never during modbus I/O
+    std::vector <std::vector <uint16_t>> blocks (reads.size ());
+    std::vector <bool> valid (reads.size (), false);
+    for (unsigned int i = 0; i < reads.size (); i++) {
+        blocks[i].resize (reads[i].second);
+        valid[i] = device_ptr_->ReadRegisters (
+            reads[i].first, reads[i].second, &blocks[i][0]
+        );
+    }
+
+    int64_t stamp = NowMilliseconds ();
+    unsigned int sequence = sequence_.load (std::memory_order_relaxed);
+    sequence_.store (sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+    for (unsigned int i = 0; i < reads.size (); i++) {
+        if (valid[i]) {
+            SunSpecPoller::Publish (
+                reads[i].first, reads[i].second, &blocks[i][0], stamp
+            );
+        }
+    }
+    sequence_.store (sequence + 2, std::memory_order_release);
+}  // end Poll
+
+// Publish
+// - copy the registers that belong to a model into the snapshot image. The
+// - registers between models (did and length headers) are dropped.
+void SunSpecPoller::Publish (unsigned int address,
+                             unsigned int length,
+                             const uint16_t* registers,
+                             int64_t stamp) {
+    for (const auto& region : regions_) {
+        unsigned int start = std::max (address, region.address);
+        unsigned int end = std::min (address + length,
+                                     region.address + region.length);
+        for (unsigned int reg = start; reg < end; reg++) {
+            unsigned int index = region.image + reg - region.address;
+            image_[index].store (registers[reg - address],
+                                 std::memory_order_relaxed);
+            stamps_[index].store (stamp, std::memory_order_relaxed);
+        }
+    }
+}  // end Publish
+
+// Read Values
+// - copy the latest model block from the snapshot and decode it. The age of
+// - each point is the time since its oldest register (or scale factor) was
+// - read, kNeverRead if it has not been polled.
+bool SunSpecPoller::ReadValues (unsigned int did,
+                                std::vector <SunSpecModel::Value>* values,
+                                std::vector <uint32_t>* ages_ms) const {
+    const Region* region = SunSpecPoller::FindRegion (did);
+    if (region == nullptr) {
+        return false;
+    }
+
+    uint16_t raw[region->length];
+    int64_t stamps[region->length];
+    unsigned int sequence;
+    do {
+        sequence = sequence_.load (std::memory_order_acquire);
+        while (sequence & 1) {
+            std::this_thread::yield ();
+            sequence = sequence_.load (std::memory_order_acquire);
+        }
+        for (unsigned int i = 0; i < region->length; i++) {
+            raw[i] = image_[region->image + i].load (std::memory_order_relaxed);
+            stamps[i]
+                = stamps_[region->image + i].load (std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence (std::memory_order_acquire);
+    } while (sequence_.load (std::memory_order_relaxed) != sequence);
+
+    region->model->BlockToValues (raw, values);
+    if (ages_ms == nullptr) {
+        return true;
+    }
+
+    const std::vector <SunSpecModel::Point>& points
+        = region->model->GetPoints ();
+    std::vector <uint32_t>& deref_ages = *ages_ms;
+    deref_ages.resize (points.size ());
+    int64_t now = NowMilliseconds ();
+    for (unsigned int i = 0; i < points.size (); i++) {
+        const SunSpecModel::Point& point = points[i];
+        int64_t oldest = INT64_MAX;
+        for (unsigned int reg = 0; reg < point.length; reg++) {
+            if (point.offset + reg < region->length) {
+                oldest = std::min (oldest, stamps[point.offset + reg]);
+            }
+        }
+        if (point.scaler >= 0) {
+            oldest = std::min (
+                oldest, stamps[region->model->scalers_[point.scaler]]
+            );
+        }
+        deref_ages[i] = (oldest <= 0 || oldest == INT64_MAX)
+            ? kNeverRead : static_cast <uint32_t> (now - oldest);
+    }
+    return true;
+}  // end Read Values
+
+// Find Region
+// - returns the snapshot region of a model or nullptr
+const SunSpecPoller::Region* SunSpecPoller::FindRegion (unsigned int did) const {
+    for (const auto& region : regions_) {
+        if (region.did == did) {
+            return &region;
+        }
+    }
+    return nullptr;
+}  // end Find Region
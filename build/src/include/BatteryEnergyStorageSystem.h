@@ -3,8 +3,12 @@
 
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "DistributedEnergyResource.h"
 #include "SunSpecModbus.h"
+#include "SunSpecPoller.h"
 #include "tsu.h"
 
 // map <property, value>>
@@ -19,12 +23,15 @@ class BatteryEnergyStorageSystem : public DistributedEnergyResource {
 
         // overwrite public methods of DER
         void Loop (float delta_time);
+        void Schedule (Scheduler* scheduler, unsigned int period_ms);
         void Display ();
 
     private:
         // class composition
         SunSpecModbus inverter_;
         SunSpecModbus bms_;
+        SunSpecPoller inverter_poller_;
+        SunSpecPoller bms_poller_;
 
     private:
         // overwrite private methods of DER
@@ -32,19 +39,57 @@ class BatteryEnergyStorageSystem : public DistributedEnergyResource {
         void ExportPower ();
         void IdleLoss ();
         void Log ();
+        void Control ();
         void GetRatedProperties ();
         void Query ();
+        void SubscribePoints ();
         void SetRadianConfigurations ();
-        void CheckBMSErrors (block_map& block);
-        void CheckRadianErrors (block_map& block);
+        void CheckBMSErrors ();
+        void CheckRadianErrors ();
+
+    private:
+        // compiled point indexes used by Query so the typed values can be
+        // accessed without string lookups
+        struct PointIndexes {
+            int ac_amps;
+            int ac_volts;
+            int ac_watts;
+            int dc_volts;
+            int events;
+            int l1_buy_amps;
+            int l2_buy_amps;
+            int l1_sell_amps;
+            int l2_sell_amps;
+            int output_kw;
+            int buy_kw;
+            int sell_kw;
+            int charge_kw;
+            int load_kw;
+            int mode;
+            int soc;
+            int faults;
+            int warnings;
+        };
 
     private:
         // static properties
         unsigned int split_vac_;
+        PointIndexes index_;
+        std::shared_ptr <SunSpecModel> sunspec_model_;
+        std::shared_ptr <SunSpecModel> split_model_;
+        std::shared_ptr <SunSpecModel> bms_model_;
+        // typed block values reused by each query
+        std::vector <SunSpecModel::Value> sunspec_values_;
+        std::vector <SunSpecModel::Value> split_values_;
+        std::vector <SunSpecModel::Value> bms_values_;
+        std::vector <uint32_t> split_ages_;
+        static const uint32_t kStaleMilliseconds = 15000;
+        static const unsigned int kControlMilliseconds = 5000;
+        std::mutex control_mutex_;  // control and log share the query values
         // dynamic properties
-        std::string bms_faults_;
-        std::string bms_warnings_;
-        std::string radian_events_;
+        uint32_t bms_faults_;
+        uint32_t bms_warnings_;
+        uint32_t radian_events_;
         std::string radian_mode_;
         unsigned int last_log_;
         unsigned int last_control_;
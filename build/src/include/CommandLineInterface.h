@@ -10,17 +10,20 @@
 // INCLUDES
 #include <string>
 #include "DistributedEnergyResource.h"
+#include "Scheduler.h"
 
 class CommandLineInterface {
     public:
         // constructor / destructor
-        CommandLineInterface (DistributedEnergyResource* der_ptr);
+        CommandLineInterface (DistributedEnergyResource* der_ptr,
+                              Scheduler* scheduler_ptr = nullptr);
         virtual ~CommandLineInterface ();
         void Help ();
         bool Control (const std::string& input);
 
     private:
         DistributedEnergyResource* der_ptr_;
+        Scheduler* scheduler_ptr_;
 
 };  // end Command Line Interface
 
@@ -12,6 +12,8 @@
 #include <string>
 #include <map>
 
+class Scheduler;
+
 class DistributedEnergyResource {
     public:
         // constructor / destructor
@@ -19,6 +21,7 @@ class DistributedEnergyResource {
         DistributedEnergyResource (std::map <std::string, std::string> init);
         virtual ~DistributedEnergyResource ();
         virtual void Loop (float delta_time);
+        virtual void Schedule (Scheduler* scheduler, unsigned int period_ms);
         virtual void Display ();
 
     public:
@@ -60,14 +63,20 @@ class DistributedEnergyResource {
         // logging
         void SetLogPath (std::string path);
         void SetLogIncrement (unsigned int inc);
+        void SetLogBinary (bool binary);
         std::string GetLogPath ();
+        unsigned int GetLogIncrement ();
+        bool GetLogBinary ();
+
+    protected:
+        // logging is shared with children that replace the controls
+        virtual void Log ();
 
     private:
         // controls
         virtual void ImportPower ();
         virtual void ExportPower ();
         virtual void IdleLoss ();
-        virtual void Log ();
 
     private:       
         // rated export
@@ -95,6 +104,7 @@ class DistributedEnergyResource {
         unsigned int last_utc_;  // used to prevent multiple logs per cycle
         unsigned int log_inc_;
         std::string log_path_;
+        bool log_binary_;        // binary columnar telemetry instead of text
 };
 
 #endif // DISTRIBUTEDENERGYRESOURCE_H_INCLUDED
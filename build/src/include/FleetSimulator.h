@@ -0,0 +1,108 @@
+// Description:
+//      This class simulates a fleet of distributed energy resources using the
+//      same power and energy model as the DER simulator. The device properties
+//      are stored as a structure of arrays so every device is advanced by one
+//      branchless loop per step that the compiler can vectorize.
+//
+//      The fleet is also a DER that represents the aggregate of all devices,
+//      so the CLI, Operator and Smart Grid Device control it through the same
+//      SetImportWatts/SetExportWatts calls. An aggregate setpoint is split
+//      between the devices by their rated power. Single devices can be
+//      controlled using the device overloads of the same methods.
+//
+//      The fleet runs paced to the wall clock by the Scheduler or as fast as
+//      possible over a simulated timeline using Simulate.
+//
+// Example:
+//      FleetSimulator fleet (configs["Fleet"]);
+//      fleet.SetImportWatts (1000000);         // aggregate
+//      fleet.SetExportWatts (42, 3000);        // device 42
+//      fleet.Simulate (24*60*60, 1);           // one day in 1 second steps
+
+#ifndef FLEETSIMULATOR_H_INCLUDED
+#define FLEETSIMULATOR_H_INCLUDED
+
+// INCLUDES
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "DistributedEnergyResource.h"
+
+class FleetSimulator : public DistributedEnergyResource {
+public:
+    // device properties, one element per device
+    struct Devices {
+        // rated properties
+        std::vector <float> rated_import_power;     // (W)
+        std::vector <float> rated_export_power;     // (W)
+        std::vector <float> rated_import_energy;    // (Wh)
+        std::vector <float> rated_export_energy;    // (Wh)
+        std::vector <float> import_ramp;            // (W s^-1)
+        std::vector <float> export_ramp;            // (W s^-1)
+        std::vector <float> idle_losses;            // (Wh h^-1)
+        // control properties
+        std::vector <float> import_watts;
+        std::vector <float> export_watts;
+        // dynamic properties
+        std::vector <float> import_power;
+        std::vector <float> export_power;
+        std::vector <float> import_energy;
+        std::vector <float> export_energy;
+    };
+
+    // called by Simulate before each step with the simulated seconds
+    typedef std::function <void (FleetSimulator*, double)> Dispatch;
+
+public:
+    // constructor / destructor
+    FleetSimulator (std::map <std::string, std::string> init);
+    virtual ~FleetSimulator ();
+
+    // overwrite public methods of DER
+    void Loop (float delta_time);
+    void Schedule (Scheduler* scheduler, unsigned int period_ms);
+    void Display ();
+
+    // device controls, the aggregate controls are inherited from DER
+    using DistributedEnergyResource::SetImportWatts;
+    using DistributedEnergyResource::SetExportWatts;
+    void SetImportWatts (unsigned int device, unsigned int power);
+    void SetExportWatts (unsigned int device, unsigned int power);
+
+    // simulation
+    void Step (float seconds);
+    void Simulate (double seconds, float step, Dispatch dispatch = nullptr);
+    unsigned int GetSize () const;
+    const Devices& GetDevices () const;
+
+private:
+    // device setpoint received from another thread
+    struct Command {
+        unsigned int device;
+        bool import;
+        unsigned int power;
+    };
+
+private:
+    void ApplyCommands ();
+    void DispatchAggregate ();
+    void UpdateAggregate ();
+
+private:
+    unsigned int size_;
+    unsigned int step_ms_;          // paced step period
+    Devices devices_;
+    float total_import_power_;      // sum of rated power used for dispatch
+    float total_export_power_;
+    unsigned int last_import_watts_;
+    unsigned int last_export_watts_;
+    float step_us_;                 // duration of the last step
+
+    std::mutex command_mutex_;
+    std::vector <Command> commands_;
+    std::vector <Command> pending_;
+};
+
+#endif // FLEETSIMULATOR_H_INCLUDED
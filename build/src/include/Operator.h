@@ -1,40 +1,77 @@
 // Author: Tylor Slay
 // Description:
 //      This class is used to automatically control a der object using a
-//      predetermined schedule. The schedule has a known format so the operator
-//      used the ScheduleHeader structure to store the information
+//      predetermined schedule. The schedule file has the known format
+//      "utc,control,setting" so each row is compiled into a compact Entry
+//      with an enumerated control type. The entries are sorted by time and
+//      the active entry is found with a time cursor that falls back to a
+//      binary search, so the lookup does not grow with the schedule length.
+//
+//      The schedule file is checked for changes by the loop and reloaded
+//      without a restart. The new schedule is compiled off to the side and
+//      swapped in atomically, so a bad file leaves the old schedule running.
+//      Writers should replace the file with a rename so a half written file
+//      is never read.
+//
+//      By default the schedule repeats daily and the day of each entry is
+//      neglected. When daily is false the entries are absolute utc times and
+//      nothing is dispatched before the first entry. A schedule that spans a
+//      day or more is never folded into one day, it runs as absolute times.
 
 #ifndef OPERATOR_H_INCLUDED
 #define OPERATOR_H_INCLUDED
 
 // INCLUDES
+#include <cstdint>
+#include <sys/types.h>
+#include <memory>
 #include <string>
 #include <vector>
 #include "DistributedEnergyResource.h"
 
 class Operator {
 public:
-    Operator (const std::string& filename, DistributedEnergyResource* der_ptr);
+    enum class Control : uint8_t { IDLE, IMPORT, EXPORT };
+
+    // since the file columns are known each row is compiled into an entry
+    struct Entry {
+        uint32_t time;      // seconds, time of day when the schedule is daily
+        uint32_t setting;   // (W)
+        Control control;
+    };
+
+    // compiled schedule that is shared with the loop while it is replaced
+    struct Schedule {
+        std::vector <Entry> entries;
+        int64_t modified;   // file time (ns)
+        off_t size;
+        bool daily;         // entry times are the time of day
+    };
+
+public:
+    Operator (const std::string& filename,
+              DistributedEnergyResource* der_ptr,
+              bool daily = true);
     virtual ~Operator ();
     void Loop ();
+    bool Reload ();
+    std::shared_ptr <const Schedule> GetSchedule () const;
 
 private:
-    // since the file columns are known we can create and object to represent
-    // the values within the column.
-    struct ScheduleHeader {
-        unsigned int time;
-        std::string control;
-        unsigned int setting;
-
-        ScheduleHeader (int time, std::string control, unsigned int setting)
-            : time(time), control(control), setting(setting) {
-        };
-    };
+    std::shared_ptr <Schedule> Compile () const;
+    size_t Find (const Schedule& schedule, uint32_t time);
+    void Dispatch (const Entry& entry);
 
 private:
-    unsigned int index_;
+    static const size_t kNone = static_cast <size_t> (-1);
+    static const unsigned int kSecondsPerDay = 60*60*24;
+
+    std::string filename_;
     DistributedEnergyResource* der_ptr_;
-    std::vector <ScheduleHeader> schedule_;
+    bool daily_;
+    size_t index_;          // active entry, also the cursor for the next find
+    std::shared_ptr <const Schedule> active_;       // owned by the loop
+    std::shared_ptr <const Schedule> schedule_;     // atomic, latest compiled
 };  // end Operator
 
 #endif // OPERATOR_H_INCLUDED
\ No newline at end of file
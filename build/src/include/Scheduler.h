@@ -0,0 +1,99 @@
+// Description:
+//      This class runs periodic tasks on absolute steady clock deadlines using
+//      a small pool of worker threads. The next deadline of a task is computed
+//      from its last deadline, not from when it finished, so the cadence does
+//      not drift with processing time. Deadlines are aligned to the wall clock
+//      so a 5 second task always runs at utc % 5 == 0 plus its phase.
+//
+//      Tasks wait in a min heap ordered by deadline. A task is removed from the
+//      heap while it runs so it never runs concurrently with itself. When a
+//      task misses its next deadline the overrun policy decides whether the
+//      missed slots are skipped, run back to back or the schedule is delayed.
+//
+// Example:
+//      Scheduler scheduler (2);
+//      scheduler.AddTask ("Control", [&]() { der.Control (); }, 5000);
+//      scheduler.Start ();
+
+#ifndef SCHEDULER_H_INCLUDED
+#define SCHEDULER_H_INCLUDED
+
+// INCLUDES
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Scheduler {
+public:
+    // overrun policy when a task misses its next deadline
+    // - SKIP: drop the missed slots and stay on the phase grid
+    // - CATCH_UP: run the missed slots back to back
+    // - DELAY: restart the period from when the task finished
+    enum class Overrun : uint8_t { SKIP, CATCH_UP, DELAY };
+
+    // task counters, times are in microseconds
+    struct Stats {
+        std::string name;
+        unsigned int period_ms;
+        uint64_t runs;
+        uint64_t overruns;          // runs that finished after the next slot
+        uint64_t skipped;           // slots dropped by the SKIP policy
+        int64_t jitter_last;        // start time minus deadline
+        int64_t jitter_max;
+        int64_t jitter_total;
+        int64_t runtime_max;
+    };
+
+public:
+    // constructor / destructor
+    Scheduler (unsigned int workers = 2);
+    virtual ~Scheduler ();
+
+    // tasks must be added before the scheduler is started
+    unsigned int AddTask (const std::string& name,
+                          std::function <void ()> task,
+                          unsigned int period_ms,
+                          unsigned int phase_ms = 0,
+                          Overrun policy = Overrun::SKIP);
+    void Start ();
+    void Stop ();
+
+    // counters
+    std::vector <Stats> GetStats ();
+    void Display ();
+
+private:
+    typedef std::chrono::steady_clock::time_point time_point;
+
+    struct Task {
+        std::function <void ()> function;
+        std::chrono::microseconds period;
+        std::chrono::microseconds phase;
+        time_point deadline;
+        Overrun policy;
+        Stats stats;
+    };
+
+private:
+    void Run ();
+    void Reschedule (unsigned int id, time_point start, time_point end);
+    void Push (unsigned int id);
+
+private:
+    unsigned int workers_;
+    std::vector <Task> tasks_;
+    std::vector <unsigned int> heap_;   // task ids ordered by deadline
+
+    std::atomic <bool> running_;
+    std::vector <std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wait_;
+};
+
+#endif // SCHEDULER_H_INCLUDED
@@ -26,10 +26,22 @@
 // Description:
 //      This class is used to handle control signals from the server as well as
 //      notify the server of property changes.
+//
+//      The properties are kept in a registry that is indexed by name so a Get
+//      is a single hash lookup. Each property remembers the last value the
+//      server received and is only published when it moves past its deadband,
+//      changes within the coalesce window are sent as one signal.
 
 #ifndef SMARTGRIDDEVICE_HPP_INCLUDED
 #define SMARTGRIDDEVICE_HPP_INCLUDED
 
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <alljoyn/Status.h>
 #include <alljoyn/BusObject.h>
 #include <alljoyn/BusAttachment.h>
@@ -41,7 +53,8 @@ public:
     SmartGridDevice (DistributedEnergyResource* der_ptr,
                      ajn::BusAttachment* bus_ptr, 
                      const char* name, 
-                     const char* path
+                     const char* path,
+                     std::map <std::string, std::string>& configs
     );
     void ImportPowerHandler (const ajn::InterfaceDescription::Member* member,
                              ajn::Message& message
@@ -56,6 +69,30 @@ public:
     QStatus SendPropertiesUpdate ();
     void Loop ();
 
+private:
+    // property registry entry, published is the last value sent to the server
+    struct Property {
+        const char* name;
+        unsigned int (DistributedEnergyResource::*getter) ();
+        float absolute;     // deadband in the units of the property
+        float relative;     // deadband as a fraction of the published value
+        unsigned int published;
+    };
+
+    // the registry keys point at the property names so the lookup does not
+    // copy the requested name
+    struct NameHash {
+        size_t operator () (const char* name) const;
+    };
+    struct NameEqual {
+        bool operator () (const char* a, const char* b) const {
+            return strcmp (a, b) == 0;
+        };
+    };
+
+private:
+    QStatus Publish (uint32_t changed);
+
 private:
     // class composition
     DistributedEnergyResource* der_ptr_;
@@ -65,10 +102,17 @@ private:
     const char* interface_;
     const char* name_;
 
+    // property registry
+    std::vector <Property> properties_;
+    std::unordered_map <const char*, unsigned int, NameHash, NameEqual> index_;
+    std::mutex property_mutex_;     // Get is called by the alljoyn threads
+
     // control properties
-    unsigned int last_telemetry_utc_;
-    unsigned int last_import_energy_;
-    unsigned int last_export_energy_;
+    uint32_t pending_;              // bit per property waiting to be sent
+    uint64_t pending_ms_;           // steady time of the first pending change
+    unsigned int coalesce_ms_;
+    unsigned int heartbeat_;        // seconds, 0 disables
+    unsigned int last_heartbeat_utc_;
 
 };
 
@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <modbus/modbus-tcp.h>
 #include "SunSpecModel.h"
 
@@ -14,35 +16,66 @@ class SunSpecModbus {
 public:
     SunSpecModbus (std::map <std::string, std::string>& configs);
     ~SunSpecModbus ();
-    void ReadRegisters (unsigned int offset,
+    bool ReadRegisters (unsigned int offset,
                         unsigned int length,
                         uint16_t *reg_ptr);
-    void WriteRegisters (unsigned int offset,
+    bool WriteRegisters (unsigned int offset,
                          unsigned int length,
                          std::vector <uint16_t> registers);
 
     std::map <std::string, std::string> ReadBlock (unsigned int did);
+    bool ReadValues (
+        unsigned int did, std::vector <SunSpecModel::Value>* values
+    );
+    std::shared_ptr <SunSpecModel> GetModel (unsigned int did);
+    const std::vector <std::shared_ptr <SunSpecModel>>& GetModels () const;
+    unsigned int GetMaxRead () const;
 
     void WriteBlock (
         unsigned int did, std::map <std::string, std::string>& points
     );
-    void WritePoint (
+    bool WritePoint (
         unsigned int did, std::map <std::string, std::string>& point
     );
+    bool WritePoints (
+        unsigned int did, std::map <std::string, std::string>& points
+    );
+    bool WriteRegisterMap (const std::map <uint16_t, uint16_t>& registers);
 
     void PrintBlock (
         std::map <std::string, std::string>& block
     );
 
+private:
+    // model chain entry, header is the register of the did and length
+    struct DeviceMapEntry {
+        unsigned int did;
+        unsigned int header;
+        unsigned int length;
+    };
+
 private:
     modbus_t* context_ptr_;
+    std::string ip_;
+    unsigned int port_;
     std::string model_path_;
+    std::string cache_path_;
+    std::string log_path_;      // error log, empty writes to the terminal
     unsigned int sunspec_key_;
+    unsigned int max_read_;   // registers per read request
+    unsigned int max_write_;  // registers per write request
+    unsigned int query_delay_;  // milliseconds between models in discovery
+    std::mutex context_mutex_;  // the modbus context is not thread safe
     std::vector <std::shared_ptr <SunSpecModel>> models_;
 
 private:
     std::string FormatModelPath (unsigned int did);
     void Query (unsigned int did);
+    bool LoadDeviceMap ();
+    void SaveDeviceMap (const std::vector <DeviceMapEntry>& device_map);
+    std::string DeviceMapPath ();
+    bool RefreshScalers (SunSpecModel& model);
+    void LogError (const std::string& message);
 };
 
 #endif // SUNSPECMODBUS_H
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <sys/stat.h>
 
 // BOOST Libs
 #include <boost/property_tree/ptree.hpp>
@@ -14,19 +15,70 @@
 // - This model uses boosts property tree to parse the xml models for
 // - modbus register blocks.
 // - https://www.technical-recipes.com/2014/using-boostproperty_tree/
+// - The property tree is only walked once by the constructor. Each point is
+// - compiled into a flat table so register blocks can be decoded without
+// - string lookups or heap allocations. The compiled table can be cached as a
+// - binary file so later starts do not parse the xml.
 class SunSpecModel {
+public:
+    // smdx point types, the order is not significant
+    enum class PointType : uint8_t {
+        INT16, UINT16, COUNT, ACC16, INT32, UINT32, FLOAT32, ACC32,
+        ENUM16, ENUM32, BITFIELD16, BITFIELD32, SUNSSF, STRING, UNSUPPORTED
+    };
+
+    // compiled smdx point
+    // - scaler is the index into the scale factor table or -1 if the point
+    // - uses a fixed multiplier (including the default multiplier of 1).
+    struct Point {
+        std::string id;
+        PointType type;
+        uint16_t offset;
+        uint16_t length;
+        int16_t scaler;
+        float multiplier;
+        std::vector <std::pair <uint32_t, std::string>> symbols;
+    };
+
+    // decoded point value
+    // - raw holds the unscaled register value and scaled holds the value
+    // - after the scale factor is applied. Enums and bitfields only use raw.
+    struct Value {
+        uint32_t raw;
+        float scaled;
+    };
+
 public:
     // constructor / destructor
     SunSpecModel (
-        unsigned int did, unsigned int offset, std::string model_path
+        unsigned int did,
+        unsigned int offset,
+        std::string model_path,
+        std::string cache_path = ""
     );
     virtual ~SunSpecModel ();
 
     // accessors
     unsigned int GetOffset ();
     unsigned int GetLength ();
+    const std::vector <Point>& GetPoints () const;
+    int GetIndex (const std::string& id) const;
 
 public:
+    void BlockToValues (
+        const uint16_t* register_block, std::vector <Value>* values
+    ) const;
+
+    std::string ValueToString (
+        unsigned int index, const Value& value
+    ) const;
+
+    const std::string& ValueToSymbol (
+        unsigned int index, const Value& value
+    ) const;
+
+    void UpdateScalers (const uint16_t* register_block);
+
     std::map <std::string, std::string> BlockToPoints (
         const std::vector <uint16_t>& register_block
     );
@@ -39,6 +91,11 @@ public:
         std::map <std::string, std::string>& points
     );
 
+    bool PointsToRegisterMap (
+        std::map <std::string, std::string>& points,
+        std::map <uint16_t, uint16_t>* registers
+    );
+
     // this operator will be used when looking for specific models
     bool operator == (const unsigned int& did) {
         return did_ == did;
@@ -46,12 +103,19 @@ public:
 
 public:
     // utility methods
-    void GetScalers ();
+    void Compile (const boost::property_tree::ptree& smdx);
 
-    float BlockToScaler (
-        const std::vector <uint16_t>& register_block,
-        std::string scaler
-    );
+    bool LoadCache (const std::string& cache_file,
+                    const struct stat& source,
+                    std::string* name);
+
+    void SaveCache (const std::string& cache_file,
+                    const struct stat& source,
+                    const std::string& name);
+
+    bool EncodePoint (const Point& point,
+                      const std::string& value,
+                      uint16_t* registers) const;
 
     float PointToScaler (
         std::map <std::string, std::string>& points,
@@ -77,9 +141,11 @@ public:
     unsigned int offset_;
     unsigned int length_;
     unsigned int did_;
-    boost::property_tree::ptree smdx_;
-    std::map <std::string, uint16_t> scalers_;
-    std::map <std::string, float> sunssf_;
+    std::vector <Point> points_;
+    std::map <std::string, unsigned int> index_;
+    std::vector <uint16_t> scalers_;  // register offset of each sunssf
+    std::vector <float> sunssf_;      // last scale factor read from device
+    bool sunssf_read_;                // sunssf_ has been read at least once
 };
 
 #endif // SUNSPECMODEL_H
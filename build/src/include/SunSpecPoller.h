@@ -0,0 +1,118 @@
+// Description:
+//      This class polls the registers of a SunSpec modbus device in its own
+//      thread so control loops never wait on modbus. Consumers subscribe to
+//      the points they use with a refresh interval, and the poller only reads
+//      those registers (plus their scale factors). Due registers are merged
+//      into as few modbus reads as possible, even across models, and then
+//      published into a seqlock protected snapshot. Readers copy the latest
+//      snapshot and the age of each point without locks or modbus I/O.
+//
+//      Point writes are queued and sent by the polling thread before the next
+//      poll, so control loops do not wait on modbus writes either. Writes to
+//      the same model are merged and a failed write drops the rest of the
+//      queue. When the poller is not running the writes are sent directly.
+//
+// Example:
+//      SunSpecPoller poller (&inverter);
+//      poller.Subscribe (64115, "GS_Split_Buy_kW", 1000);
+//      poller.Start ();
+//      poller.ReadValues (64115, &values, &ages);
+//      poller.WritePoints (64116, points);
+
+#ifndef SUNSPECPOLLER_H_INCLUDED
+#define SUNSPECPOLLER_H_INCLUDED
+
+// INCLUDES
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SunSpecModbus.h"
+
+class SunSpecPoller {
+public:
+    // constructor / destructor
+    SunSpecPoller (SunSpecModbus* device_ptr, unsigned int max_gap = 16);
+    virtual ~SunSpecPoller ();
+
+    // subscriptions must be made before the poller is started
+    bool Subscribe (unsigned int did,
+                    const std::string& id,
+                    unsigned int interval_ms);
+    void Start ();
+    void Stop ();
+    void Poll ();
+
+    // snapshot readers
+    bool ReadValues (unsigned int did,
+                     std::vector <SunSpecModel::Value>* values,
+                     std::vector <uint32_t>* ages_ms = nullptr) const;
+
+    // queued writes, false if the model is unknown or a direct write failed
+    bool WritePoints (unsigned int did,
+                      const std::map <std::string, std::string>& points);
+
+    // point age when it has never been read
+    static const uint32_t kNeverRead = UINT32_MAX;
+
+private:
+    // register range of a model within the snapshot image
+    struct Region {
+        unsigned int did;
+        unsigned int address;   // first modbus register
+        unsigned int length;
+        unsigned int image;     // first index in the snapshot image
+        std::shared_ptr <SunSpecModel> model;
+    };
+
+    // points of one model waiting to be written
+    struct PendingWrite {
+        unsigned int did;
+        std::map <std::string, std::string> points;
+    };
+
+    // subscribed point registers and its scale factor register
+    struct Subscription {
+        unsigned int address;
+        unsigned int length;
+        int scaler;             // scale factor address or -1
+        std::chrono::milliseconds interval;
+        std::chrono::steady_clock::time_point next_due;
+    };
+
+private:
+    void Run ();
+    void FlushWrites ();
+    const Region* FindRegion (unsigned int did) const;
+    void Publish (unsigned int address,
+                  unsigned int length,
+                  const uint16_t* registers,
+                  int64_t stamp);
+
+private:
+    SunSpecModbus* device_ptr_;
+    unsigned int max_gap_;      // unused registers allowed in a merged read
+    std::vector <Region> regions_;
+    std::vector <Subscription> subscriptions_;
+
+    // seqlock snapshot, odd sequence means a write is in progress
+    std::atomic <unsigned int> sequence_;
+    std::unique_ptr <std::atomic <uint16_t>[]> image_;
+    std::unique_ptr <std::atomic <int64_t>[]> stamps_;  // ms, 0 never read
+    unsigned int image_size_;
+
+    // polling thread
+    std::atomic <bool> running_;
+    std::thread thread_;
+    std::mutex wait_mutex_;     // also guards the pending writes
+    std::condition_variable wait_;
+    std::vector <PendingWrite> writes_;
+};
+
+#endif // SUNSPECPOLLER_H_INCLUDED
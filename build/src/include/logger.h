@@ -4,16 +4,66 @@
 // 		along with the context, path arguments and then passes all further args
 // 		using the (<<) operator.
 //
-// Example: 
-// Logger("INFO") << "Data\t" << "More Data";
+// 		The message is built into a fixed size record and pushed to a lock-free
+// 		ring buffer. A single writer thread keeps the daily log files open,
+// 		batches the writes and syncs them to disk on a fixed interval, so the
+// 		calling thread never waits on file I/O. If the ring buffer is full the
+// 		record is dropped and counted instead of blocking the caller. Messages
+// 		longer than the record are truncated, flagged in the log and counted.
+//
+// 		Telemetry works the same way, but only takes numbers and is stored in
+// 		a binary columnar file (.tlm) that can be converted to TSV using the
+// 		telemetry_tsv tool.
+//
+// Example:
+// Logger("INFO", path) << "Data\t" << "More Data";
+// Telemetry("DER_Data", path, "import_watts,import_power") << 10 << 9.5;
 
 #ifndef LOGGER_H_INCLUDED
 #define LOGGER_H_INCLUDED
 
 // INCLUDES
+#include <cstdint>
 #include <string>
 #include <sstream>
 
+// Log Record
+// - fixed size record passed from the logging threads to the writer thread
+struct LogRecord {
+	enum Kind : uint8_t { TEXT, TELEMETRY };
+	static const unsigned int kMaxColumns = 16;
+
+	Kind kind;
+	bool valid;
+	bool truncated;           // message or values did not fit the record
+	uint16_t length;          // message bytes or telemetry columns
+	int64_t utc_us;           // system clock microseconds
+	const char* columns;      // telemetry column names (string literal)
+	char context[32];
+	char path[160];
+	union {
+		char message[288];
+		float values[kMaxColumns];
+	};
+};
+
+// Telemetry file format
+// - file header and column names followed by blocks of rows. Each block
+// - stores the timestamps and then each column contiguously.
+// - file:  TelemetryHeader | names | block | block | ...
+// - block: TelemetryBlock | int64 utc_us[rows] | float column[rows] ...
+struct TelemetryHeader {
+	char magic[4];            // DCST
+	uint32_t version;
+	uint32_t columns;
+	uint32_t names_length;
+};
+
+struct TelemetryBlock {
+	char magic[4];            // BLCK
+	uint32_t rows;
+};
+
 class Logger {
 public:
 	// Constructor/Destructor
@@ -21,24 +71,54 @@ public:
 	virtual ~Logger ();
 
 	// Operator Overloads
+	// - common types are written straight into the record, anything else
+	// - uses a string stream to convert it into a string
 	template <typename T>
 	Logger& operator << (T rhs) {
-		// string stream is a simple way to convert any data type into a string
-	    std::ostringstream ss;
-	    ss << rhs;
-		msg_ += ss.str();
+		std::ostringstream ss;
+		ss << rhs;
+		std::string text = ss.str ();
+		Logger::Append (text.c_str (), text.size ());
 		return *this;
 	};
+	Logger& operator << (const std::string& rhs);
+	Logger& operator << (const char* rhs);
+	Logger& operator << (char rhs);
+	Logger& operator << (int rhs);
+	Logger& operator << (unsigned int rhs);
+	Logger& operator << (long rhs);
+	Logger& operator << (unsigned long rhs);
+	Logger& operator << (long long rhs);
+	Logger& operator << (unsigned long long rhs);
+	Logger& operator << (float rhs);
+	Logger& operator << (double rhs);
+
+	// writer settings
+	static void SetSyncInterval (unsigned int seconds);
+	static uint64_t GetDropped ();
+	static uint64_t GetTruncated ();
+	static uint64_t GetMismatched ();
+	static void Flush ();
+
+private:
+	LogRecord record_;
 
 private:
-	std::string msg_;
-	std::string context_;
-	std::string path_;
+	void Append (const char* text, size_t length);
+};
+
+class Telemetry {
+public:
+	// Constructor/Destructor
+	// - columns must be a string literal of comma separated column names
+	Telemetry (std::string context, std::string path, const char* columns);
+	virtual ~Telemetry ();
+
+	// Operator Overloads
+	Telemetry& operator << (float rhs);
 
 private:
-	void ToFile ();
-	std::string GetDate ();
-	std::string GetDateTime ();
+	LogRecord record_;
 };
 
 #endif // LOGGER_H_INCLUDED
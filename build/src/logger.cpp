@@ -1,48 +1,555 @@
 #include "include/logger.h"
 #include <iostream>
-#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
 
-// the constructor starts the message with DateTime
-Logger::Logger (std::string context, std::string path) 
-	: context_(context), path_(path) {
-	msg_ =  Logger::GetDateTime () + '\t';
+// number of records the ring buffer can hold, must be a power of two
+static const size_t kRingSize = 1024;
+
+// rows held in memory before a telemetry block is written
+static const unsigned int kBlockRows = 256;
+
+// Now Microseconds
+// - system clock time used to stamp each record
+static int64_t NowMicroseconds () {
+	return std::chrono::duration_cast <std::chrono::microseconds> (
+		std::chrono::system_clock::now ().time_since_epoch ()
+	).count ();
+}
+
+// Copy Field
+// - copy a string into a fixed size record field, false if it did not fit
+static bool CopyField (char* field, size_t size, const std::string& value) {
+	if (value.size () >= size) {
+		field[0] = '\0';
+		return false;
+	}
+	std::memcpy (field, value.c_str (), value.size () + 1);
+	return true;
+}
+
+// Log Writer
+// - owns the ring buffer and the thread that writes records to file. The ring
+// - buffer is a bounded multi-producer queue where each slot has a sequence
+// - number, so producers only contend on a single atomic increment and the
+// - writer never takes a lock.
+class LogWriter {
+public:
+	static LogWriter& Instance () {
+		static LogWriter writer;
+		return writer;
+	}
+
+	bool Push (const LogRecord& record);
+	void SetSyncInterval (unsigned int seconds) { sync_seconds_ = seconds; };
+	uint64_t GetDropped () { return dropped_; };
+	uint64_t GetTruncated () { return truncated_; };
+	uint64_t GetMismatched () { return mismatched_; };
+	void Flush ();
+
+private:
+	// ring buffer slot
+	struct Slot {
+		std::atomic <size_t> sequence;
+		LogRecord record;
+	};
+
+	// open log file and the telemetry rows waiting to be written
+	struct LogFile {
+		FILE* file;
+		bool dirty;
+		unsigned int columns;
+		std::vector <int64_t> utc_us;
+		std::vector <float> values;   // column major, kBlockRows per column
+	};
+
+private:
+	LogWriter ();
+	~LogWriter ();
+	bool Pop (LogRecord* record);
+	void Run ();
+	void Write (const LogRecord& record);
+	void WriteText (const LogRecord& record);
+	void WriteTelemetry (const LogRecord& record);
+	void WriteBlock (LogFile* log_file);
+	LogFile* Open (const std::string& file_name, const LogRecord& record);
+	void FlushFiles (bool sync);
+	void CloseFiles ();
+	const char* FormatTime (int64_t utc_us, bool date_only);
+
+private:
+	std::unique_ptr <Slot[]> ring_;
+	std::atomic <size_t> enqueue_;
+	size_t dequeue_;
+	std::atomic <uint64_t> dropped_;      // ring buffer was full
+	std::atomic <uint64_t> truncated_;    // message did not fit the record
+	std::atomic <uint64_t> mismatched_;   // telemetry columns did not match
+	std::atomic <unsigned int> sync_seconds_;
+	std::atomic <bool> flush_;
+
+	// writer thread state
+	std::map <std::string, LogFile> files_;
+	std::string date_;
+	time_t format_second_;
+	char date_time_[32];
+	char date_only_[16];
+
+	std::atomic <bool> running_;
+	std::thread thread_;
+	std::mutex wait_mutex_;
+	std::condition_variable wait_;
+};
+
+LogWriter::LogWriter ()
+	: ring_(new Slot[kRingSize]),
+	  enqueue_(0),
+	  dequeue_(0),
+	  dropped_(0),
+	  truncated_(0),
+	  mismatched_(0),
+	  sync_seconds_(60),
+	  flush_(false),
+	  format_second_(-1),
+	  running_(true) {
+	for (size_t i = 0; i < kRingSize; i++) {
+		ring_[i].sequence.store (i, std::memory_order_relaxed);
+	}
+	thread_ = std::thread (&LogWriter::Run, this);
+}  // end constructor
+
+// the writer is destroyed at program exit, so it drains anything left in the
+// ring buffer before closing the files
+LogWriter::~LogWriter () {
+	{
+		std::lock_guard <std::mutex> lock (wait_mutex_);
+		running_ = false;
+	}
+	wait_.notify_all ();
+	if (thread_.joinable ()) {
+		thread_.join ();
+	}
+}  // end destructor
+
+// Push
+// - claim the next slot and copy the record into it. The record is dropped if
+// - the writer has fallen a full ring behind.
+bool LogWriter::Push (const LogRecord& record) {
+	size_t position = enqueue_.load (std::memory_order_relaxed);
+	Slot* slot;
+	while (true) {
+		slot = &ring_[position & (kRingSize - 1)];
+		size_t sequence = slot->sequence.load (std::memory_order_acquire);
+		intptr_t difference = static_cast <intptr_t> (sequence)
+			- static_cast <intptr_t> (position);
+		if (difference == 0) {
+			if (enqueue_.compare_exchange_weak (
+					position, position + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			dropped_++;
+			return false;
+		} else {
+			position = enqueue_.load (std::memory_order_relaxed);
+		}
+	}
+	slot->record = record;
+	slot->sequence.store (position + 1, std::memory_order_release);
+	return true;
+}  // end Push
+
+// Pop
+// - single consumer, only called by the writer thread
+bool LogWriter::Pop (LogRecord* record) {
+	Slot* slot = &ring_[dequeue_ & (kRingSize - 1)];
+	size_t sequence = slot->sequence.load (std::memory_order_acquire);
+	if (sequence != dequeue_ + 1) {
+		return false;
+	}
+	*record = slot->record;
+	slot->sequence.store (dequeue_ + kRingSize, std::memory_order_release);
+	dequeue_++;
+	return true;
+}  // end Pop
+
+// Flush
+// - ask the writer to write pending telemetry blocks and sync all files
+void LogWriter::Flush () {
+	flush_ = true;
+	wait_.notify_all ();
+}  // end Flush
+
+// Run
+// - drain the ring buffer in batches. Text is flushed to the os after every
+// - batch, telemetry blocks are written when full and files are synced to
+// - disk on the sync interval. Producers never signal the writer, it wakes on
+// - a short timeout so pushing a record stays lock free.
+void LogWriter::Run () {
+	LogRecord record;
+	auto next_sync = std::chrono::steady_clock::now ()
+		+ std::chrono::seconds (sync_seconds_);
+	bool running = true;
+	uint64_t reported = 0;
+	uint64_t reported_truncated = 0;
+	uint64_t reported_mismatched = 0;
+
+	while (running) {
+		running = running_;
+		bool wrote = false;
+		while (LogWriter::Pop (&record)) {
+			LogWriter::Write (record);
+			wrote = true;
+		}
+
+		auto now = std::chrono::steady_clock::now ();
+		bool sync = !running || flush_.exchange (false) || now >= next_sync;
+		if (sync) {
+			next_sync = now + std::chrono::seconds (sync_seconds_);
+			uint64_t dropped = dropped_;
+			if (dropped != reported) {
+				std::cout << "[ERROR]\t" << "Logger: dropped "
+					<< dropped - reported << " records\n";
+				reported = dropped;
+			}
+			uint64_t truncated = truncated_;
+			if (truncated != reported_truncated) {
+				std::cout << "[ERROR]\t" << "Logger: truncated "
+					<< truncated - reported_truncated << " records\n";
+				reported_truncated = truncated;
+			}
+			uint64_t mismatched = mismatched_;
+			if (mismatched != reported_mismatched) {
+				std::cout << "[ERROR]\t" << "Logger: dropped "
+					<< mismatched - reported_mismatched
+					<< " telemetry rows with the wrong column count\n";
+				reported_mismatched = mismatched;
+			}
+		}
+		if (wrote || sync) {
+			LogWriter::FlushFiles (sync);
+		}
+
+		if (running) {
+			std::unique_lock <std::mutex> lock (wait_mutex_);
+			wait_.wait_for (lock, std::chrono::milliseconds (100), [this]() {
+				return !running_ || flush_;
+			});
+		}
+	}
+	LogWriter::CloseFiles ();
+}  // end Run
+
+// Write
+// - files are only kept open for the current day, when the date changes the
+// - files from the previous day are written and closed.
+void LogWriter::Write (const LogRecord& record) {
+	std::string date = LogWriter::FormatTime (record.utc_us, true);
+	if (date != date_) {
+		LogWriter::CloseFiles ();
+		date_ = date;
+	}
+
+	if (record.kind == LogRecord::TEXT) {
+		LogWriter::WriteText (record);
+	} else {
+		LogWriter::WriteTelemetry (record);
+	}
+}  // end Write
+
+// Write Text
+// - constructs the filename based on the date and context of the logger. A
+// - truncated message is flagged at the end of the line.
+void LogWriter::WriteText (const LogRecord& record) {
+	std::string file_name = std::string (record.path) + record.context
+		+ "_" + date_ + ".log";
+	LogFile* log_file = LogWriter::Open (file_name, record);
+	if (log_file == nullptr) {
+		return;
+	}
+	std::fputs (LogWriter::FormatTime (record.utc_us, false), log_file->file);
+	std::fputc ('\t', log_file->file);
+	std::fwrite (record.message, 1, record.length, log_file->file);
+	if (record.truncated) {
+		std::fputs ("\t[TRUNCATED]", log_file->file);
+		truncated_++;
+	}
+	std::fputc ('\n', log_file->file);
+	log_file->dirty = true;
+}  // end Write Text
+
+// Write Telemetry
+// - add the row to the files pending block, records that do not match the
+// - columns of the file are dropped and counted apart from the ring buffer.
+void LogWriter::WriteTelemetry (const LogRecord& record) {
+	std::string file_name = std::string (record.path) + record.context
+		+ "_" + date_ + ".tlm";
+	LogFile* log_file = LogWriter::Open (file_name, record);
+	if (log_file == nullptr) {
+		return;
+	}
+	if (record.length != log_file->columns || record.truncated) {
+		mismatched_++;
+		return;
+	}
+
+	unsigned int row = log_file->utc_us.size ();
+	log_file->utc_us.push_back (record.utc_us);
+	for (unsigned int i = 0; i < log_file->columns; i++) {
+		log_file->values[i * kBlockRows + row] = record.values[i];
+	}
+	if (log_file->utc_us.size () == kBlockRows) {
+		LogWriter::WriteBlock (log_file);
+	}
+}  // end Write Telemetry
+
+// Write Block
+// - write the pending telemetry rows as one block, one column at a time
+void LogWriter::WriteBlock (LogFile* log_file) {
+	uint32_t rows = log_file->utc_us.size ();
+	if (rows == 0) {
+		return;
+	}
+	TelemetryBlock block = {{'B', 'L', 'C', 'K'}, rows};
+	std::fwrite (&block, sizeof (block), 1, log_file->file);
+	std::fwrite (&log_file->utc_us[0], sizeof (int64_t), rows, log_file->file);
+	for (unsigned int i = 0; i < log_file->columns; i++) {
+		std::fwrite (&log_file->values[i * kBlockRows],
+		             sizeof (float),
+		             rows,
+		             log_file->file);
+	}
+	log_file->utc_us.clear ();
+	log_file->dirty = true;
+}  // end Write Block
+
+// Open
+// - get the open file or open it for append. New telemetry files start with
+// - the header and column names, existing files must have the same columns.
+LogWriter::LogFile* LogWriter::Open (const std::string& file_name,
+                                     const LogRecord& record) {
+	auto it = files_.find (file_name);
+	if (it != files_.end ()) {
+		return it->second.file == nullptr ? nullptr : &it->second;
+	}
+
+	LogFile& log_file = files_[file_name];
+	log_file.file = std::fopen (file_name.c_str (), "ab+");
+	log_file.dirty = false;
+	log_file.columns = 0;
+	if (log_file.file == nullptr) {
+		std::cout << "[ERROR]\t" << "Logger: failed to open " << file_name
+			<< '\n';
+		return nullptr;
+	}
+	if (record.kind == LogRecord::TEXT) {
+		return &log_file;
+	}
+
+	std::fseek (log_file.file, 0, SEEK_END);
+	if (std::ftell (log_file.file) == 0) {
+		uint32_t names_length = std::strlen (record.columns);
+		TelemetryHeader header
+			= {{'D', 'C', 'S', 'T'}, 1, record.length, names_length};
+		std::fwrite (&header, sizeof (header), 1, log_file.file);
+		std::fwrite (record.columns, 1, names_length, log_file.file);
+		log_file.columns = record.length;
+	} else {
+		TelemetryHeader header;
+		std::rewind (log_file.file);
+		if (std::fread (&header, sizeof (header), 1, log_file.file) == 1
+			&& std::memcmp (header.magic, "DCST", 4) == 0) {
+			log_file.columns = header.columns;
+		} else {
+			std::cout << "[ERROR]\t" << "Logger: invalid telemetry file "
+				<< file_name << '\n';
+		}
+		std::fseek (log_file.file, 0, SEEK_END);
+	}
+	log_file.values.resize (log_file.columns * kBlockRows);
+	return &log_file;
+}  // end Open
+
+// Flush Files
+// - push written data to the os and sync it to disk on the sync interval
+void LogWriter::FlushFiles (bool sync) {
+	for (auto& it : files_) {
+		LogFile& log_file = it.second;
+		if (log_file.file == nullptr) {
+			continue;
+		}
+		if (sync) {
+			LogWriter::WriteBlock (&log_file);
+		}
+		if (log_file.dirty) {
+			std::fflush (log_file.file);
+			if (sync) {
+				fsync (fileno (log_file.file));
+				log_file.dirty = false;
+			}
+		}
+	}
+}  // end Flush Files
+
+// Close Files
+void LogWriter::CloseFiles () {
+	LogWriter::FlushFiles (true);
+	for (auto& it : files_) {
+		if (it.second.file != nullptr) {
+			std::fclose (it.second.file);
+		}
+	}
+	files_.clear ();
+}  // end Close Files
+
+// Format Time
+// - local date or date time of a record. The conversion is cached for the
+// - current second since most records in a batch share it.
+const char* LogWriter::FormatTime (int64_t utc_us, bool date_only) {
+	time_t utc = utc_us / 1000000;
+	if (utc != format_second_) {
+		struct tm ts;
+		localtime_r (&utc, &ts);
+		strftime (date_time_, sizeof (date_time_), "%F %T", &ts);
+		strftime (date_only_, sizeof (date_only_), "%F", &ts);
+		format_second_ = utc;
+	}
+	return date_only ? date_only_ : date_time_;
+}  // end Format Time
+
+// the constructor stamps the record with the time, the date time string is
+// formatted by the writer thread
+Logger::Logger (std::string context, std::string path) {
+	record_.kind = LogRecord::TEXT;
+	record_.truncated = false;
+	record_.length = 0;
+	record_.utc_us = NowMicroseconds ();
+	record_.columns = nullptr;
+	record_.valid = CopyField (record_.context, sizeof (record_.context), context)
+		&& CopyField (record_.path, sizeof (record_.path), path);
 }  // end constructor
 
 // becuase the logger object is constructor inline, it is destroyed at the end
-// of the line which then writes the message to the log file.
+// of the line which then passes the message to the writer thread.
 Logger::~Logger () {
-	Logger::ToFile ();
+	if (!record_.valid) {
+		std::cout << "[ERROR]\t" << "Logger: context or path too long\n";
+		return;
+	}
+	LogWriter::Instance ().Push (record_);
+}  // end destructor
+
+// Append
+// - add text to the message, anything past the record size is truncated
+void Logger::Append (const char* text, size_t length) {
+	size_t space = sizeof (record_.message) - record_.length;
+	if (length > space) {
+		length = space;
+		record_.truncated = true;
+	}
+	std::memcpy (record_.message + record_.length, text, length);
+	record_.length += length;
+}  // end Append
+
+Logger& Logger::operator << (const std::string& rhs) {
+	Logger::Append (rhs.c_str (), rhs.size ());
+	return *this;
+}
+
+Logger& Logger::operator << (const char* rhs) {
+	Logger::Append (rhs, std::strlen (rhs));
+	return *this;
+}
+
+Logger& Logger::operator << (char rhs) {
+	Logger::Append (&rhs, 1);
+	return *this;
+}
+
+// numbers are formatted the same as the default string stream format
+#define LOGGER_FORMAT(type, format)                                           \
+Logger& Logger::operator << (type rhs) {                                      \
+	char buf[32];                                                             \
+	int length = std::snprintf (buf, sizeof (buf), format, rhs);              \
+	Logger::Append (buf, length);                                             \
+	return *this;                                                             \
+}
+
+LOGGER_FORMAT (int, "%d")
+LOGGER_FORMAT (unsigned int, "%u")
+LOGGER_FORMAT (long, "%ld")
+LOGGER_FORMAT (unsigned long, "%lu")
+LOGGER_FORMAT (long long, "%lld")
+LOGGER_FORMAT (unsigned long long, "%llu")
+LOGGER_FORMAT (float, "%g")
+LOGGER_FORMAT (double, "%g")
+
+#undef LOGGER_FORMAT
+
+// Set Sync Interval
+// - seconds between syncing the log files to disk
+void Logger::SetSyncInterval (unsigned int seconds) {
+	LogWriter::Instance ().SetSyncInterval (seconds);
+}  // end Set Sync Interval
+
+// Get Dropped
+// - records dropped because the ring buffer was full
+uint64_t Logger::GetDropped () {
+	return LogWriter::Instance ().GetDropped ();
+}  // end Get Dropped
+
+// Get Truncated
+// - text records that were cut to the message size
+uint64_t Logger::GetTruncated () {
+	return LogWriter::Instance ().GetTruncated ();
+}  // end Get Truncated
+
+// Get Mismatched
+// - telemetry rows dropped because the columns did not match the file
+uint64_t Logger::GetMismatched () {
+	return LogWriter::Instance ().GetMismatched ();
+}  // end Get Mismatched
+
+// Flush
+void Logger::Flush () {
+	LogWriter::Instance ().Flush ();
+}  // end Flush
+
+Telemetry::Telemetry (std::string context,
+                      std::string path,
+                      const char* columns) {
+	record_.kind = LogRecord::TELEMETRY;
+	record_.truncated = false;
+	record_.length = 0;
+	record_.utc_us = NowMicroseconds ();
+	record_.columns = columns;
+	record_.valid = CopyField (record_.context, sizeof (record_.context), context)
+		&& CopyField (record_.path, sizeof (record_.path), path);
+}  // end constructor
+
+Telemetry::~Telemetry () {
+	if (!record_.valid) {
+		std::cout << "[ERROR]\t" << "Telemetry: context or path too long\n";
+		return;
+	}
+	LogWriter::Instance ().Push (record_);
 }  // end destructor
 
-// To File
-// - constructs the filename based on the date and context of the logger
-void Logger::ToFile  () {
-	std::string file_name = path_ + context_ + "_" + Logger::GetDate () 
-		+ ".log";
-	std::ofstream output_file(file_name, std::ios_base::app);
-	if (output_file.is_open()) {
-		output_file << msg_ << '\n';
-	}
-	output_file.close();
-}  // end To File
-
-// Get Date
-// - gets the local time date for the file name
-std::string Logger::GetDate () {
-    time_t now = time(0);
-    struct tm ts = *localtime(&now);
-    char buf[100];
-    strftime(buf, sizeof(buf), "%F", &ts);
-    return std::string(buf);
-} // end Get Date
-
-// Get Date Time
-// - gets the local date and time for indexing of the data
-std::string Logger::GetDateTime () {
-    time_t now = time(0);
-    struct tm ts = *localtime(&now);
-    char buf[100];
-    strftime(buf, sizeof(buf), "%F %T", &ts);
-    return std::string(buf);
-} // end Get Date Time
+// values past the max columns do not fit the record, the row is dropped
+Telemetry& Telemetry::operator << (float rhs) {
+	if (record_.length < LogRecord::kMaxColumns) {
+		record_.values[record_.length++] = rhs;
+	} else {
+		record_.truncated = true;
+	}
+	return *this;
+}
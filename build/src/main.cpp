@@ -31,17 +31,18 @@
 
 // INCLUDES
 #include <iostream>
-#include <thread>
-#include <chrono>
 #include <string>
 #include <vector>
 #include <map>
 #include "include/BatteryEnergyStorageSystem.h"
+#include "include/FleetSimulator.h"
 #include "include/CommandLineInterface.h"
 #include "include/Operator.h"
 #include "include/SmartGridDevice.h"
 #include "include/ServerListener.h"
+#include "include/Scheduler.h"
 #include "include/tsu.h"
+#include "include/logger.h"
 #include "include/aj_utility.h"
 
 // NAMESPACES
@@ -110,87 +111,6 @@ static std::map <std::string, std::string> ArgumentParser (int argc,
     return parameters;
 }  // end Argument Parser
 
-// THREADS
-// -------
-
-// Resource Loop
-// - this loop runs the resource control loop at the desired frequency
-// - it subtracks processing time of the Loop () function to make the frequency
-// - more consistant
-void ResourceLoop (unsigned int sleep, DistributedEnergyResource* der_ptr) {
-    unsigned int time_remaining, time_past;
-    unsigned int time_wait = sleep;
-    auto time_start = chrono::high_resolution_clock::now();
-    auto time_end = chrono::high_resolution_clock::now();
-    chrono::duration<double, milli> time_elapsed;
-
-    while (!done) {
-        time_start = chrono::high_resolution_clock::now();
-            // time since last control call;
-            time_elapsed = time_start - time_end;
-            time_past = time_elapsed.count();
-            der_ptr->Loop(time_past);
-        time_end = chrono::high_resolution_clock::now();
-        time_elapsed = time_end - time_start;
-
-        // determine sleep duration after deducting process time
-        if (time_wait - time_elapsed.count() > 0) {
-            time_remaining = time_wait - time_elapsed.count();
-            this_thread::sleep_for (chrono::milliseconds (time_remaining));
-        } 
-    }
-}  // end Resource Loop
-
-// Operator Loop
-// - this loop runs the resource control loop at the desired frequency
-// - it subtracks processing time of the Loop () function to make the frequency
-// - more consistant
-void OperatorLoop (unsigned int sleep, Operator* oper_ptr) {
-    unsigned int time_remaining;
-    unsigned int time_wait = sleep;
-    auto time_start = chrono::high_resolution_clock::now();
-    auto time_end = chrono::high_resolution_clock::now();
-    chrono::duration<double, milli> time_elapsed;
-
-    while (!done && scheduled) {
-        time_start = chrono::high_resolution_clock::now();
-        oper_ptr->Loop();
-        time_end = chrono::high_resolution_clock::now();
-        time_elapsed = time_end - time_start;
-
-        // determine sleep duration after deducting process time
-        if (time_wait - time_elapsed.count() > 0) {
-            time_remaining = time_wait - time_elapsed.count();
-            this_thread::sleep_for (chrono::milliseconds (time_remaining));
-        } 
-    }
-}  // end Resource Loop
-
-// Smart Grid Device Loop
-// - this loop runs the resource control loop at the desired frequency
-// - it subtracks processing time of the Loop () function to make the frequency
-// - more consistant
-void SmartGridDeviceLoop (unsigned int sleep, SmartGridDevice* sgd_ptr) {
-    unsigned int time_remaining;
-    unsigned int time_wait = sleep;
-    auto time_start = chrono::high_resolution_clock::now();
-    auto time_end = chrono::high_resolution_clock::now();
-    chrono::duration<double, milli> time_elapsed;
-
-    while (!done) {
-        time_start = chrono::high_resolution_clock::now();
-        sgd_ptr->Loop();
-        time_end = chrono::high_resolution_clock::now();
-        time_elapsed = time_end - time_start;
-
-        // determine sleep duration after deducting process time
-        if (time_wait - time_elapsed.count() > 0) {
-            time_remaining = time_wait - time_elapsed.count();
-            this_thread::sleep_for (chrono::milliseconds (time_remaining));
-        } 
-    }
-}  // end Resource Loop
-
 // Main
 // ----
 int main (int argc, char** argv) {
@@ -210,19 +130,44 @@ int main (int argc, char** argv) {
 
     // read config file for program configurations and object attributes
     tsu::config_map configs = tsu::MapConfigFile (arguments["config"]);
+    if (configs["Logger"].count ("sync")) {
+        Logger::SetSyncInterval (stoul(configs["Logger"]["sync"]));
+    }
 
     cout << "\tCreating Distributed Energy Resource\n";
     // ~ reference DistributedEnergyResource and BatteryEnergyStorageSystem
-    BatteryEnergyStorageSystem* der_ptr 
-        = new BatteryEnergyStorageSystem(configs);
+    // - a simulated fleet replaces the BESS when the fleet has devices
+    DistributedEnergyResource* der_ptr;
+    if (configs["Fleet"].count ("devices") 
+        && stoul(configs["Fleet"]["devices"]) > 0) {
+        // ~ reference FleetSimulator
+        der_ptr = new FleetSimulator(configs["Fleet"]);
+    } else {
+        der_ptr = new BatteryEnergyStorageSystem(configs);
+    }
 
     cout << "\tCreating Operator\n";
     // ~ reference Operator.h
-    Operator* oper_ptr = new Operator(configs["Operator"]["schedule"], der_ptr);
+    bool daily = true;
+    if (configs["Operator"].count ("repeat")) {
+        daily = configs["Operator"]["repeat"] == "daily";
+    }
+    Operator* oper_ptr = new Operator(configs["Operator"]["schedule"],
+                                      der_ptr,
+                                      daily);
+
+    cout << "\tCreating Scheduler\n";
+    // ~ reference Scheduler.h
+    unsigned int period = stoul(configs["Threads"]["sleep"]);
+    unsigned int workers = 2;
+    if (configs["Threads"].count ("workers")) {
+        workers = stoul(configs["Threads"]["workers"]);
+    }
+    Scheduler scheduler (workers);
 
     cout << "\tCreating Command Line Interface\n";
     // ~ reference CommandLineInterface.h
-    CommandLineInterface CLI(der_ptr);
+    CommandLineInterface CLI(der_ptr, &scheduler);
 
     cout << "\tCreating AllJoyn Message Bus\n";
     try {
@@ -300,7 +245,8 @@ int main (int argc, char** argv) {
     SmartGridDevice *sgd_ptr = new SmartGridDevice(der_ptr, 
                                                    bus_ptr, 
                                                    device_name, 
-                                                   path.c_str());
+                                                   path.c_str(),
+                                                   configs["AllJoyn"]);
 
     cout << "\t\tRegistering AllJoyn Smart Grid Device\n";
     if (ER_OK != bus_ptr->RegisterBusObject(*sgd_ptr)){
@@ -309,15 +255,18 @@ int main (int argc, char** argv) {
     }
     about_ptr->Announce(port, about_data);
 
-    // most objects will have a dedicated thread, but not all
-    cout << "\tSpawning threads...\n";
-    thread DER (ResourceLoop, stoul(configs["Threads"]["sleep"]), der_ptr);
-    thread OPER (
-    	OperatorLoop, stoul(configs["Threads"]["sleep"]), oper_ptr
-    );
-    thread SGD (
-    	SmartGridDeviceLoop, stoul(configs["Threads"]["sleep"]), sgd_ptr
-    );
+    // objects register periodic tasks that share the scheduler worker threads
+    cout << "\tScheduling tasks...\n";
+    der_ptr->Schedule (&scheduler, period);
+    scheduler.AddTask ("Operator", [oper_ptr]() {
+        if (scheduled) {
+            oper_ptr->Loop ();
+        }
+    }, period);
+    scheduler.AddTask ("SGD", [sgd_ptr]() {
+        sgd_ptr->Loop ();
+    }, period);
+    scheduler.Start ();
 
     // the CLI will control the program and can signal the program to stop
 	cout << "Initialization complete...\n";
@@ -333,11 +282,9 @@ int main (int argc, char** argv) {
     // - dont really explain the shutdown procedure for lots of alljoyn objects
 	cout << "Closing program...\n";
 
-	// First join all active threads to main thread
-	cout << "\tJoining threads\n";
-	DER.join ();
-	OPER.join ();
-	SGD.join ();
+	// First stop the scheduler so no tasks run during shutdown
+	cout << "\tStopping scheduler\n";
+	scheduler.Stop ();
 
     cout << "\tUnregistering AllJoyn objects\n";
     obs_ptr->UnregisterListener (*listner_ptr);
@@ -0,0 +1,293 @@
+// INCLUDES
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include "SunSpecEmulator.h"
+#include "SunSpecModel.h"
+
+SunSpecEmulator::SunSpecEmulator (
+    std::map <std::string, std::string>& configs)
+    : model_path_(configs["path"]),
+      port_(stoul (configs["port"])),
+      latency_(0),
+      fault_rate_(0),
+      fault_(Fault::EXCEPTION),
+      random_(42),
+      server_socket_(-1),
+      running_(false),
+      requests_(0),
+      faults_(0),
+      connections_(0) {
+    if (configs.count ("latency") == 1) {
+        latency_ = stoul (configs["latency"]);
+    }
+    if (configs.count ("fault_rate") == 1) {
+        fault_rate_ = stof (configs["fault_rate"]);
+    }
+    if (configs["fault"] == "timeout") {
+        fault_ = Fault::TIMEOUT;
+    } else if (configs["fault"] == "disconnect") {
+        fault_ = Fault::DISCONNECT;
+    }
+
+    // the whole register address space so any start address can be served
+    context_ptr_ = modbus_new_tcp ("127.0.0.1", port_);
+    mapping_ptr_ = modbus_mapping_new (0, 0, 0x10000, 0);
+    if (!context_ptr_ || !mapping_ptr_) {
+        std::cout << "[ERROR]\t" << "Emulator: " << modbus_strerror (errno)
+            << '\n';
+        return;
+    }
+
+    if (configs.count ("models") == 1) {
+        // SunSpec ID "SunS" followed by the model chain and the end model
+        uint16_t* registers = mapping_ptr_->tab_registers;
+        registers[kSunSpecStart] = 0x5375;
+        registers[kSunSpecStart + 1] = 0x6E53;
+        unsigned int header = kSunSpecStart + 2;
+        std::stringstream ss (configs["models"]);
+        std::string did;
+        while (std::getline (ss, did, ',')) {
+            if (!SunSpecEmulator::AddModel (stoul (did), header)) {
+                break;
+            }
+            header += 2 + registers[header + 1];
+        }
+        registers[header] = 0xFFFF;
+        registers[header + 1] = 0;
+    } else {
+        SunSpecEmulator::AddModel (stoul (configs["did"]), 0);
+    }
+}  // end constructor
+
+SunSpecEmulator::~SunSpecEmulator () {
+    SunSpecEmulator::Stop ();
+    if (mapping_ptr_) {
+        modbus_mapping_free (mapping_ptr_);
+    }
+    if (context_ptr_) {
+        modbus_free (context_ptr_);
+    }
+}  // end destructor
+
+// Add Model
+// - compile the smdx model and write the default point values. A header of
+// - 0 places the block at register 0 without the did and length registers.
+bool SunSpecEmulator::AddModel (unsigned int did, unsigned int header) {
+    std::stringstream ss;
+    ss << model_path_ << "smdx_" << std::setfill ('0') << std::setw (5) << did
+        << ".xml";
+    struct stat buffer;
+    if (stat (ss.str ().c_str (), &buffer) != 0) {
+        std::cout << "[ERROR]\t" << "Emulator: model not found " << ss.str ()
+            << '\n';
+        return false;
+    }
+
+    SunSpecModel model (did, header, ss.str ());
+    unsigned int offset = model.GetOffset ();
+    unsigned int length = model.GetLength ();
+    if (offset + length + 2 > 0x10000) {
+        std::cout << "[ERROR]\t" << "Emulator: model " << did
+            << " does not fit the register map\n";
+        return false;
+    }
+
+    uint16_t* registers = mapping_ptr_->tab_registers;
+    if (header != 0) {
+        registers[header] = did;
+        registers[header + 1] = length;
+    }
+
+    uint16_t* block = &registers[offset];
+    for (const auto& point : model.GetPoints ()) {
+        uint16_t value = 1 + point.offset % 100;
+        switch (point.type) {
+            case SunSpecModel::PointType::SUNSSF:
+            case SunSpecModel::PointType::BITFIELD16:
+            case SunSpecModel::PointType::BITFIELD32:
+            case SunSpecModel::PointType::UNSUPPORTED:
+                break;
+            case SunSpecModel::PointType::ENUM16:
+            case SunSpecModel::PointType::ENUM32:
+                if (!point.symbols.empty ()) {
+                    block[point.offset] = point.symbols[0].first;
+                }
+                break;
+            case SunSpecModel::PointType::STRING:
+                for (unsigned int i = 0; i < point.length; i++) {
+                    char high = (2*i < point.id.size ()) ? point.id[2*i] : 0;
+                    char low = (2*i + 1 < point.id.size ())
+                        ? point.id[2*i + 1] : 0;
+                    block[point.offset + i] = (high << 8) | uint8_t (low);
+                }
+                break;
+            default:
+                block[point.offset] = value;
+                break;
+        }
+    }
+    return true;
+}  // end Add Model
+
+// Start
+// - listen on the loopback address and serve requests on a thread
+bool SunSpecEmulator::Start () {
+    if (running_ || !context_ptr_ || !mapping_ptr_) {
+        return running_;
+    }
+    server_socket_ = modbus_tcp_listen (context_ptr_, 8);
+    if (server_socket_ == -1) {
+        std::cout << "[ERROR]\t" << "Emulator: port " << port_ << " , "
+            << modbus_strerror (errno) << '\n';
+        return false;
+    }
+    running_ = true;
+    thread_ = std::thread (&SunSpecEmulator::Run, this);
+    return true;
+}  // end Start
+
+// Stop
+// - join the server thread and close every connection
+void SunSpecEmulator::Stop () {
+    running_ = false;
+    if (thread_.joinable ()) {
+        thread_.join ();
+    }
+    for (int client : clients_) {
+        close (client);
+    }
+    clients_.clear ();
+    if (server_socket_ != -1) {
+        close (server_socket_);
+        server_socket_ = -1;
+    }
+}  // end Stop
+
+// Run
+// - wait for new connections and requests. The select timeout is short so
+// - Stop does not wait long for the thread.
+void SunSpecEmulator::Run () {
+    while (running_) {
+        fd_set sockets;
+        FD_ZERO (&sockets);
+        FD_SET (server_socket_, &sockets);
+        int max_socket = server_socket_;
+        for (int client : clients_) {
+            FD_SET (client, &sockets);
+            max_socket = std::max (max_socket, client);
+        }
+
+        struct timeval timeout = {0, 100000};
+        int ready = select (max_socket + 1, &sockets, NULL, NULL, &timeout);
+        if (ready <= 0) {
+            continue;
+        }
+
+        if (FD_ISSET (server_socket_, &sockets)) {
+            int listen_socket = server_socket_;
+            int client = modbus_tcp_accept (context_ptr_, &listen_socket);
+            if (client != -1) {
+                clients_.push_back (client);
+                connections_++;
+            }
+        }
+
+        for (auto it = clients_.begin (); it != clients_.end ();) {
+            if (FD_ISSET (*it, &sockets) && !SunSpecEmulator::Serve (*it)) {
+                close (*it);
+                it = clients_.erase (it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}  // end Run
+
+// Serve
+// - answer one request from the client, false if the connection is closed
+bool SunSpecEmulator::Serve (int socket) {
+    uint8_t query[MODBUS_TCP_MAX_ADU_LENGTH];
+    modbus_set_socket (context_ptr_, socket);
+    int length = modbus_receive (context_ptr_, query);
+    if (length == 0) {
+        return true;   // request for another unit
+    } else if (length < 0) {
+        return false;
+    }
+    requests_++;
+
+    unsigned int latency = latency_;
+    if (latency > 0) {
+        std::this_thread::sleep_for (std::chrono::microseconds (latency));
+    }
+
+    if (SunSpecEmulator::InjectFault ()) {
+        faults_++;
+        switch (fault_.load ()) {
+            case Fault::EXCEPTION: {
+                modbus_reply_exception (
+                    context_ptr_, query, MODBUS_EXCEPTION_SLAVE_OR_SERVER_FAILURE
+                );
+                return true;
+            }
+            case Fault::TIMEOUT: {
+                return true;
+            }
+            case Fault::DISCONNECT: {
+                return false;
+            }
+        }
+    }
+
+    std::lock_guard <std::mutex> lock (mapping_mutex_);
+    return modbus_reply (context_ptr_, query, length, mapping_ptr_) != -1;
+}  // end Serve
+
+// Inject Fault
+// - true for the configured fraction of requests
+bool SunSpecEmulator::InjectFault () {
+    float rate = fault_rate_;
+    if (rate <= 0) {
+        return false;
+    }
+    std::uniform_real_distribution <float> chance (0, 1);
+    return chance (random_) < rate;
+}  // end Inject Fault
+
+void SunSpecEmulator::SetLatency (unsigned int microseconds) {
+    latency_ = microseconds;
+}
+
+void SunSpecEmulator::SetFaults (float rate, Fault fault) {
+    fault_ = fault;
+    fault_rate_ = rate;
+}
+
+uint16_t SunSpecEmulator::GetRegister (unsigned int address) {
+    std::lock_guard <std::mutex> lock (mapping_mutex_);
+    return mapping_ptr_->tab_registers[address & 0xFFFF];
+}
+
+void SunSpecEmulator::SetRegister (unsigned int address, uint16_t value) {
+    std::lock_guard <std::mutex> lock (mapping_mutex_);
+    mapping_ptr_->tab_registers[address & 0xFFFF] = value;
+}
+
+unsigned int SunSpecEmulator::GetPort () const {
+    return port_;
+}
+
+SunSpecEmulator::Stats SunSpecEmulator::GetStats () const {
+    Stats stats;
+    stats.requests = requests_;
+    stats.faults = faults_;
+    stats.connections = connections_;
+    return stats;
+}
@@ -0,0 +1,101 @@
+// Description:
+//      Local Modbus TCP server that emulates a SunSpec device so the modbus
+//      path can be run without the Radian or the BMS. The register map is
+//      built from the smdx models. A SunSpec device has the SunSpec ID at
+//      40000 followed by the model chain and the end model, a non-SunSpec
+//      device has a single model at register 0 like the BMS.
+//
+//      Each point is given a default value by type so every point decodes:
+//      scale factors are 0, enums use their first symbol and strings hold the
+//      point id. Writes are stored so they can be read back.
+//
+//      Every request can be delayed by a fixed latency and a fraction of the
+//      requests can be failed with an exception, dropped (the client times
+//      out) or answered by closing the connection.
+//
+// Configs:
+//      path        smdx model directory
+//      port        tcp port, bound to 127.0.0.1
+//      models      comma separated model chain for a SunSpec device
+//      did         model at register 0 when there is no model chain
+//      latency     response delay in microseconds (default 0)
+//      fault_rate  fraction of requests that fail (default 0)
+//      fault       exception, timeout or disconnect (default exception)
+//
+// Example:
+//      SunSpecEmulator radian (configs["RadianEmulator"]);
+//      radian.Start ();
+
+#ifndef SUNSPECEMULATOR_H_INCLUDED
+#define SUNSPECEMULATOR_H_INCLUDED
+
+// INCLUDES
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <modbus/modbus-tcp.h>
+
+class SunSpecEmulator {
+public:
+    enum class Fault { EXCEPTION, TIMEOUT, DISCONNECT };
+
+    // request counters
+    struct Stats {
+        uint64_t requests;
+        uint64_t faults;
+        uint64_t connections;
+    };
+
+public:
+    // constructor / destructor
+    SunSpecEmulator (std::map <std::string, std::string>& configs);
+    virtual ~SunSpecEmulator ();
+
+    // server control
+    bool Start ();
+    void Stop ();
+
+    // the latency and faults can be changed while the server is running
+    void SetLatency (unsigned int microseconds);
+    void SetFaults (float rate, Fault fault);
+
+    // direct register access for the values the device reports
+    uint16_t GetRegister (unsigned int address);
+    void SetRegister (unsigned int address, uint16_t value);
+    unsigned int GetPort () const;
+    Stats GetStats () const;
+
+private:
+    bool AddModel (unsigned int did, unsigned int header);
+    void Run ();
+    bool Serve (int socket);
+    bool InjectFault ();
+
+private:
+    static const unsigned int kSunSpecStart = 40000;
+
+    std::string model_path_;
+    unsigned int port_;
+    std::atomic <unsigned int> latency_;
+    std::atomic <float> fault_rate_;
+    std::atomic <Fault> fault_;
+    std::mt19937 random_;
+
+    modbus_t* context_ptr_;
+    modbus_mapping_t* mapping_ptr_;
+    std::mutex mapping_mutex_;      // the server thread writes the mapping
+    int server_socket_;
+    std::vector <int> clients_;
+
+    std::atomic <bool> running_;
+    std::thread thread_;
+    std::atomic <uint64_t> requests_;
+    std::atomic <uint64_t> faults_;
+    std::atomic <uint64_t> connections_;
+};
+
+#endif // SUNSPECEMULATOR_H_INCLUDED
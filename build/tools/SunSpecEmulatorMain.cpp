@@ -0,0 +1,54 @@
+// Description:
+//      Run SunSpec device emulators from the sections of a config file so the
+//      DCS can be started without hardware. Point the ip and port of [Radian]
+//      and [BMS] at the emulators and start the DCS in another terminal.
+//
+// Example:
+//      ./bin/tools/sunspec_emulator ../data/config.ini RadianEmulator BMSEmulator
+
+// INCLUDES
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "SunSpecEmulator.h"
+#include "tsu.h"
+
+int main (int argc, char** argv) {
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " <config.ini> <section>...\n";
+        return EXIT_FAILURE;
+    }
+
+    tsu::config_map configs = tsu::MapConfigFile (argv[1]);
+    std::vector <std::unique_ptr <SunSpecEmulator>> emulators;
+    for (int i = 2; i < argc; i++) {
+        if (configs.count (argv[i]) == 0) {
+            std::cerr << "[ERROR]\t" << "missing section " << argv[i] << '\n';
+            return EXIT_FAILURE;
+        }
+        std::unique_ptr <SunSpecEmulator> emulator (
+            new SunSpecEmulator (configs[argv[i]])
+        );
+        if (!emulator->Start ()) {
+            return EXIT_FAILURE;
+        }
+        std::cout << argv[i] << " listening on 127.0.0.1:"
+            << emulator->GetPort () << '\n';
+        emulators.push_back (std::move (emulator));
+    }
+
+    std::cout << "Press enter to stop\n";
+    std::string input;
+    std::getline (std::cin, input);
+
+    for (const auto& emulator : emulators) {
+        SunSpecEmulator::Stats stats = emulator->GetStats ();
+        std::cout << "port " << emulator->GetPort ()
+            << "\tconnections " << stats.connections
+            << "\trequests " << stats.requests
+            << "\tfaults " << stats.faults << '\n';
+        emulator->Stop ();
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Description:
+//      Convert a binary columnar telemetry file (.tlm) written by the Telemetry
+//      logger into tab separated values. The first row holds the column names
+//      and each following row starts with the local date time of the record.
+//      Values are printed with enough digits to read back the same float.
+//
+// Example:
+//      ./bin/tools/telemetry_tsv ~/dev/LOGS/BESS/DATA_2020-01-01.tlm > data.tsv
+
+// INCLUDES
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "logger.h"
+
+int main (int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <file.tlm>\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream file (argv[1], std::ios::binary);
+    if (!file.is_open ()) {
+        std::cerr << "[ERROR]\t" << "failed to open " << argv[1] << '\n';
+        return EXIT_FAILURE;
+    }
+
+    file.seekg (0, std::ios::end);
+    const std::streamoff file_size = file.tellg ();
+    file.seekg (0, std::ios::beg);
+
+    TelemetryHeader header;
+    if (!file.read (reinterpret_cast <char*> (&header), sizeof (header))
+        || std::memcmp (header.magic, "DCST", 4) != 0
+        || header.version != 1
+        || header.columns == 0
+        || header.columns > LogRecord::kMaxColumns
+        || header.names_length > file_size - file.tellg ()) {
+        std::cerr << "[ERROR]\t" << "invalid telemetry file " << argv[1] << '\n';
+        return EXIT_FAILURE;
+    }
+
+    std::string names (header.names_length, '\0');
+    if (!file.read (&names[0], header.names_length)) {
+        std::cerr << "[ERROR]\t" << "invalid telemetry file " << argv[1] << '\n';
+        return EXIT_FAILURE;
+    }
+    for (auto& c : names) {
+        if (c == ',') {
+            c = '\t';
+        }
+    }
+    std::cout << "time\t" << names << '\n';
+    std::cout << std::setprecision (std::numeric_limits <float>::max_digits10);
+
+    TelemetryBlock block;
+    std::vector <int64_t> utc_us;
+    std::vector <float> values;
+    char date_time[32];
+    while (file.read (reinterpret_cast <char*> (&block), sizeof (block))) {
+        // each row is a timestamp and one value per column, a block that needs
+        // more rows than the file has left is corrupt
+        const std::streamoff row_size
+            = sizeof (int64_t) + header.columns * sizeof (float);
+        if (std::memcmp (block.magic, "BLCK", 4) != 0
+            || block.rows > (file_size - file.tellg ()) / row_size) {
+            std::cerr << "[ERROR]\t" << "invalid block\n";
+            return EXIT_FAILURE;
+        }
+        if (block.rows == 0) {
+            continue;
+        }
+
+        utc_us.resize (block.rows);
+        values.resize (block.rows * header.columns);
+        file.read (reinterpret_cast <char*> (utc_us.data ()),
+                   block.rows * sizeof (int64_t));
+        file.read (reinterpret_cast <char*> (values.data ()),
+                   values.size () * sizeof (float));
+        if (!file) {
+            std::cerr << "[ERROR]\t" << "truncated block\n";
+            return EXIT_FAILURE;
+        }
+
+        // blocks are column major, rows are rebuilt one value per column
+        for (unsigned int row = 0; row < block.rows; row++) {
+            time_t utc = utc_us[row] / 1000000;
+            struct tm ts;
+            localtime_r (&utc, &ts);
+            strftime (date_time, sizeof (date_time), "%F %T", &ts);
+            std::cout << date_time;
+            for (unsigned int col = 0; col < header.columns; col++) {
+                std::cout << '\t' << values[col * block.rows + row];
+            }
+            std::cout << '\n';
+        }
+    }
+    return 0;
+}